@@ -0,0 +1,645 @@
+//                                      __
+//     ____ ___  ___  ____ ___  ____   / /__   __
+//    / __ `__ \/ _ \/ __ `__ \/ __ \ / __/ | / /
+//   / / / / / /  __/ / / / / / /_/ // /_ | |/ /
+//  /_/ /_/ /_/\___/_/ /_/ /_/\____(_)__/ |___/
+//
+//
+//  Created by Memo Akten, www.memo.tv
+//
+//  benchmarks for msa::OrderedMap
+//  build in release mode, timings are in microseconds
+//
+
+
+#include "ofxMSAOrderedMap.h"
+#include "ofxMSAPoolAllocator.h"
+#include "ofxMSAInternedString.h"
+#include "ofxMSAOrderedSlotMap.h"
+#include "ofMain.h"
+
+
+// this will store our output
+stringstream outputStream;
+
+
+// count heap allocations, to check that lookups don't allocate (and how many bytes are asked for)
+// every form of new and delete is replaced, so that each allocation is counted and freed by its matching delete
+uint64_t numAllocations = 0;
+uint64_t numBytesAllocated = 0;
+
+void* countedAllocate(size_t size, size_t alignment) {
+    numAllocations++;
+    numBytesAllocated += size;
+    void* p;
+    if(alignment <= alignof(max_align_t)) {
+        p = malloc(size ? size : 1);
+    } else {
+#ifdef _MSC_VER
+        p = _aligned_malloc(size ? size : 1, alignment);
+#else
+        p = aligned_alloc(alignment, (max(size, size_t(1)) + alignment - 1) / alignment * alignment);
+#endif
+    }
+    if(!p) throw bad_alloc();
+    return p;
+}
+
+void countedFree(void* p, size_t alignment) {
+#ifdef _MSC_VER
+    if(alignment > alignof(max_align_t)) { _aligned_free(p); return; }
+#else
+    (void)alignment;    // aligned_alloc blocks are freed with free
+#endif
+    free(p);
+}
+
+void* operator new(size_t size)                                         { return countedAllocate(size, 0); }
+void* operator new[](size_t size)                                       { return countedAllocate(size, 0); }
+void* operator new(size_t size, align_val_t alignment)                  { return countedAllocate(size, size_t(alignment)); }
+void* operator new[](size_t size, align_val_t alignment)                { return countedAllocate(size, size_t(alignment)); }
+
+void operator delete(void* p) noexcept                                  { countedFree(p, 0); }
+void operator delete[](void* p) noexcept                                { countedFree(p, 0); }
+void operator delete(void* p, size_t) noexcept                          { countedFree(p, 0); }
+void operator delete[](void* p, size_t) noexcept                        { countedFree(p, 0); }
+void operator delete(void* p, align_val_t alignment) noexcept           { countedFree(p, size_t(alignment)); }
+void operator delete[](void* p, align_val_t alignment) noexcept         { countedFree(p, size_t(alignment)); }
+void operator delete(void* p, size_t, align_val_t alignment) noexcept   { countedFree(p, size_t(alignment)); }
+void operator delete[](void* p, size_t, align_val_t alignment) noexcept { countedFree(p, size_t(alignment)); }
+
+// checks which failed (e.g. a lookup which allocated), the app exits with an error if there are any
+int numFailures = 0;
+
+
+// keys used by all benchmarks, long enough to not fit in the small string buffer
+vector<string> makeKeys(int n) {
+    vector<string> keys;
+    for(int i=0; i<n; i++) keys.push_back("/scene/layer/" + ofToString(i));
+    return keys;
+}
+
+
+// how to erase items in the erase benchmarks
+enum EraseMode {
+    kEraseFront,            // erase index 0 each time (everything after it moves)
+    kEraseBack,             // erase the last item each time
+    kEraseFrontUnordered,   // eraseUnordered index 0 each time (the last item moves into its place)
+    kEraseFrontTombstones   // erase index 0 each time, leaving tombstones which are compacted when they're half the storage
+};
+
+
+// time how long it takes to empty a map of n items, erasing one item at a time
+template<typename MapType>
+void benchmarkErase(string name, int n, EraseMode mode) {
+    vector<string> keys = makeKeys(n);
+    MapType m;
+    for(int i=0; i<n; i++) m.push_back(keys[i], i);
+    if(mode == kEraseFrontTombstones) m.setCompactionThreshold(0.5);
+
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    switch(mode) {
+        case kEraseFront: while(m.size() > 0) m.erase(0); break;
+        case kEraseBack: while(m.size() > 0) m.erase(m.size() - 1); break;
+        case kEraseFrontUnordered: while(m.size() > 0) m.eraseUnordered(0); break;
+        case kEraseFrontTombstones: while(m.size() > 0) m.erase(0); break;
+    }
+    uint64_t time = ofGetElapsedTimeMicros() - startTime;
+
+    string modeNames[] = { "(front)     ", "(back)      ", "(unordered) ", "(tombstones)" };
+    outputStream << name << " n: " << n << " " << modeNames[mode]
+                 << " total: " << time << " per erase: " << double(time) / n << endl;
+}
+
+
+template<typename MapType>
+void benchmarkErase(string name) {
+    int sizes[] = { 1000, 4000, 16000 };   // x4 each time, to show how the cost scales
+    for(int n : sizes) benchmarkErase<MapType>(name, n, kEraseFront);
+    for(int n : sizes) benchmarkErase<MapType>(name, n, kEraseBack);
+    for(int n : sizes) benchmarkErase<MapType>(name, n, kEraseFrontUnordered);
+    for(int n : sizes) benchmarkErase<MapType>(name, n, kEraseFrontTombstones);
+    outputStream << endl;
+}
+
+
+// time random edits (insert or erase) in the middle of a map of n items
+template<typename MapType>
+void benchmarkMiddleEdits(string name, int n, int numEdits) {
+    vector<string> keys = makeKeys(n + numEdits);
+    MapType m;
+    for(int i=0; i<n; i++) m.push_back(keys[i], i);
+
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    for(int i=0; i<numEdits; i++) {
+        int index = (i * 7919) % m.size();
+        if(i % 2) m.erase(index);
+        else m.insertAt(index, keys[n + i], i);
+    }
+    uint64_t time = ofGetElapsedTimeMicros() - startTime;
+
+    outputStream << name << " n: " << n << " total: " << time << " per edit: " << double(time) / numEdits << endl;
+}
+
+
+template<typename MapType>
+void benchmarkMiddleEdits(string name) {
+    int sizes[] = { 10000, 100000, 1000000 };
+    for(int n : sizes) benchmarkMiddleEdits<MapType>(name, n, 200);
+    outputStream << endl;
+}
+
+// time adding n items, copying the keys in with push_back, or moving them in with emplace_back
+// (with and without reserving room for them first)
+template<typename MapType>
+void benchmarkBulkLoad(string name, int n) {
+    vector<string> keys = makeKeys(n);
+    vector<string> keysToMove = keys;
+    vector<string> keysToMoveReserved = keys;
+
+    MapType m1;
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    for(int i=0; i<n; i++) m1.push_back(keys[i], i);
+    uint64_t pushTime = ofGetElapsedTimeMicros() - startTime;
+
+    MapType m2;
+    startTime = ofGetElapsedTimeMicros();
+    for(int i=0; i<n; i++) m2.emplace_back(std::move(keysToMove[i]), i);
+    uint64_t emplaceTime = ofGetElapsedTimeMicros() - startTime;
+
+    MapType m3;
+    startTime = ofGetElapsedTimeMicros();
+    m3.reserve(n);
+    for(int i=0; i<n; i++) m3.emplace_back(std::move(keysToMoveReserved[i]), i);
+    uint64_t reserveTime = ofGetElapsedTimeMicros() - startTime;
+
+    outputStream << name << " n: " << n << " push_back: " << pushTime << " emplace_back: " << emplaceTime << " reserve + emplace_back: " << reserveTime << endl;
+}
+
+
+// heap memory per item of a map of n items with long path like keys, counting the bytes asked for (not the allocator's overhead)
+// the map reserves room for all the items first, so nothing is freed while it's filled
+template<typename MapType>
+void benchmarkMemory(string name, int n) {
+    vector<string> keys;
+    for(int i=0; i<n; i++) keys.push_back("/scene/layer/material/param" + ofToString(i));
+
+    uint64_t startBytes = numBytesAllocated;
+    uint64_t startAllocations = numAllocations;
+    MapType m;
+    m.reserve(n);
+    for(int i=0; i<n; i++) m.push_back(keys[i], i);
+    uint64_t bytes = numBytesAllocated - startBytes;
+    uint64_t allocations = numAllocations - startAllocations;
+
+    outputStream << name << " n: " << n << " bytes per item: " << double(bytes) / n << " allocations per item: " << double(allocations) / n << endl;
+}
+
+
+// time walking all n items in order, by index (keyFor and operator[]) and with iterators
+template<typename MapType>
+void benchmarkIterate(string name, int n) {
+    vector<string> keys = makeKeys(n);
+    MapType m;
+    for(int i=0; i<n; i++) m.push_back(keys[i], i);
+
+    size_t sum = 0;
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    for(int i=0; i<m.size(); i++) sum += m.keyFor(i).size() + m[i];
+    uint64_t indexTime = ofGetElapsedTimeMicros() - startTime;
+
+    startTime = ofGetElapsedTimeMicros();
+    for(auto&& [key, value] : m) sum += key.size() + value;
+    uint64_t iteratorTime = ofGetElapsedTimeMicros() - startTime;
+
+    outputStream << name << " n: " << n << " by index: " << indexTime << " iterators: " << iteratorTime << " (" << sum << ")" << endl;
+}
+
+
+#ifdef MSA_ORDEREDMAP_PMR
+// time building a map of n items and clearing it, repeated numFrames times (e.g. a map rebuilt every frame)
+// with the default allocator, or allocating everything from a monotonic_buffer_resource which is released in one go
+template<typename MapType, typename PmrMapType>
+void benchmarkFrameMaps(string name, int n, int numFrames) {
+    vector<string> keys = makeKeys(n);
+
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    for(int frame=0; frame<numFrames; frame++) {
+        MapType m;
+        for(int i=0; i<n; i++) m.emplace_back(typename MapType::key_type(keys[i]), i);
+    }
+    uint64_t defaultTime = ofGetElapsedTimeMicros() - startTime;
+
+    std::pmr::monotonic_buffer_resource frameMemory;
+    startTime = ofGetElapsedTimeMicros();
+    for(int frame=0; frame<numFrames; frame++) {
+        {
+            PmrMapType m(&frameMemory);
+            for(int i=0; i<n; i++) m.emplace_back(typename PmrMapType::key_type(keys[i], &frameMemory), i);
+        }
+        frameMemory.release();
+    }
+    uint64_t pmrTime = ofGetElapsedTimeMicros() - startTime;
+
+    outputStream << name << " n: " << n << " frames: " << numFrames << " default allocator: " << defaultTime << " monotonic_buffer_resource: " << pmrTime << endl;
+}
+#endif
+
+
+// time insert / erase churn on a map of n items: erase a random item and add a new one, numOps times
+// then change the key of a random item, numOps times
+// the keys are numbers, so the only allocations are the index nodes (and the vectors)
+template<typename MapType>
+void benchmarkChurn(string name, int n, int numOps, const typename MapType::allocator_type& allocator) {
+    MapType m(allocator);
+    for(long i=0; i<n; i++) m.push_back(i, int(i));
+
+    uint32_t seed = 1;
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    for(long i=0; i<numOps; i++) {
+        seed = seed * 1664525 + 1013904223;
+        m.eraseUnordered(int(seed % m.size()));
+        m.push_back(n + i, int(i));
+    }
+    uint64_t time = ofGetElapsedTimeMicros() - startTime;
+
+    startTime = ofGetElapsedTimeMicros();
+    for(long i=0; i<numOps; i++) {
+        seed = seed * 1664525 + 1013904223;
+        m.changeKey(int(seed % m.size()), n + numOps + i);
+    }
+    uint64_t changeKeyTime = ofGetElapsedTimeMicros() - startTime;
+
+    outputStream << name << " n: " << n << " total: " << time << " per insert + erase: " << double(time) / numOps << " per changeKey: " << double(changeKeyTime) / numOps << endl;
+}
+
+
+template<typename Index>
+void benchmarkChurn(string name) {
+    typedef msa::OrderedMap<long, int, Index> DefaultMap;
+    typedef msa::OrderedMap<long, int, Index, msa::DenseOrder, msa::PoolAllocator<int> > PooledMap;
+    benchmarkChurn<DefaultMap>(name + " (default allocator)       ", 100000, 1000000, allocator<int>());
+    benchmarkChurn<PooledMap>(name + " (PoolAllocator)           ", 100000, 1000000, msa::PoolAllocator<int>());
+    benchmarkChurn<PooledMap>(name + " (PoolAllocator huge pages)", 100000, 1000000, msa::PoolAllocator<int>(true));
+}
+
+
+// time building lots of tiny maps (e.g. parameter sets per object) and looking up each item, and count allocations per map
+// (with inlineStorage, fails if a map allocates anything)
+template<typename MapType>
+void benchmarkSmallMaps(string name, int numMaps, int n, bool reserve, bool inlineStorage) {
+    vector<string> keys;
+    for(int i=0; i<n; i++) keys.push_back("param" + ofToString(i));    // short enough for the small string buffer
+
+    uint64_t startAllocations = numAllocations;
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    vector<MapType> maps(numMaps);
+    int sum = 0;
+    for(MapType& m : maps) {
+        if(reserve) m.reserve(n);
+        for(int i=0; i<n; i++) m.push_back(keys[i], i);
+        for(int i=0; i<n; i++) sum += m[keys[i]];
+    }
+    uint64_t time = ofGetElapsedTimeMicros() - startTime;
+    uint64_t allocations = numAllocations - startAllocations;
+
+    outputStream << name << (reserve ? " + reserve" : "          ") << " maps: " << numMaps << " n: " << n
+                 << " total: " << time << " allocations per map: " << double(allocations) / numMaps << " (" << sum << ")" << endl;
+
+    if(inlineStorage && allocations > 1) {     // the vector of maps is one allocation
+        outputStream << name << " FAILED: small maps allocated" << endl;
+        numFailures++;
+    }
+}
+
+
+template<typename MapType>
+void benchmarkSmallMaps(string name, bool inlineStorage = false) {
+    benchmarkSmallMaps<MapType>(name, 100000, 8, false, inlineStorage);
+    benchmarkSmallMaps<MapType>(name, 100000, 8, true, inlineStorage);
+}
+
+
+// time building lots of maps with the same (long) keys and looking up each item, and count allocations per map
+// with string keys every map copies every key, with InternedString keys they're just pointers into the pool
+template<typename MapType>
+void benchmarkSharedKeys(string name, int numMaps, int n) {
+    vector<typename MapType::key_type> keys;
+    for(int i=0; i<n; i++) keys.push_back(string("/scene/layer/material/param") + ofToString(i));
+
+    uint64_t startAllocations = numAllocations;
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    vector<MapType> maps(numMaps);
+    int sum = 0;
+    for(MapType& m : maps) {
+        m.reserve(n);
+        for(int i=0; i<n; i++) m.push_back(keys[i], i);
+        for(int i=0; i<n; i++) sum += m[keys[i]];
+    }
+    uint64_t time = ofGetElapsedTimeMicros() - startTime;
+    uint64_t allocations = numAllocations - startAllocations;
+
+    outputStream << name << " maps: " << numMaps << " n: " << n << " total: " << time
+                 << " allocations per map: " << double(allocations) / numMaps << " (" << sum << ")" << endl;
+}
+
+
+// time looking up the same few names every frame in a bigger map, by key and with tokens resolved once up front
+template<typename MapType>
+void benchmarkTokens(string name, int n, int numNames, int numFrames) {
+    vector<string> keys = makeKeys(n);
+    MapType m;
+    for(int i=0; i<n; i++) m.push_back(keys[i], i);
+
+    vector<string> names;
+    for(int i=0; i<numNames; i++) names.push_back(keys[i * (n / numNames)]);
+
+    int64_t sum = 0;
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    for(int f=0; f<numFrames; f++) {
+        for(const string& key : names) sum += m[key];
+    }
+    uint64_t keyTime = ofGetElapsedTimeMicros() - startTime;
+
+    vector<typename MapType::Token> tokens;
+    for(const string& key : names) tokens.push_back(m.tokenFor(key));
+    startTime = ofGetElapsedTimeMicros();
+    for(int f=0; f<numFrames; f++) {
+        for(const auto& token : tokens) sum += m[token];
+    }
+    uint64_t tokenTime = ofGetElapsedTimeMicros() - startTime;
+
+    uint64_t numLookups = uint64_t(numNames) * numFrames;
+    outputStream << name << " n: " << n << " names: " << numNames << " frames: " << numFrames
+                 << " per lookup by key: " << double(keyTime) / numLookups << " by token: " << double(tokenTime) / numLookups << " (" << sum << ")" << endl;
+}
+
+
+// time a registry of n named items (e.g. entities) where random items are erased and new ones added at the end,
+// keeping the order, numOps times. OrderedMap erases by key, OrderedSlotMap by handle
+template<typename MapType>
+void benchmarkRegistry(string name, int n, int numOps) {
+    MapType m;
+    vector<string> keys;    // the live keys (in no particular order)
+    for(int i=0; i<n; i++) {
+        keys.push_back("/scene/entity/" + ofToString(i));
+        m.push_back(keys.back(), i);
+    }
+
+    uint32_t seed = 1;
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    for(int i=0; i<numOps; i++) {
+        seed = seed * 1664525 + 1013904223;
+        int k = seed % keys.size();
+        m.erase(keys[k]);
+        keys[k] = "/scene/entity/" + ofToString(n + i);
+        m.push_back(keys[k], i);
+    }
+    uint64_t time = ofGetElapsedTimeMicros() - startTime;
+
+    outputStream << name << " n: " << n << " total: " << time << " per erase + insert: " << double(time) / numOps << endl;
+}
+
+template<typename SlotMapType>
+void benchmarkSlotMapRegistry(string name, int n, int numOps) {
+    SlotMapType m;
+    vector<typename SlotMapType::Handle> handles;   // the live items (in no particular order)
+    for(int i=0; i<n; i++) handles.push_back(m.push_back("/scene/entity/" + ofToString(i), int(i)));
+
+    uint32_t seed = 1;
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    for(int i=0; i<numOps; i++) {
+        seed = seed * 1664525 + 1013904223;
+        int k = seed % handles.size();
+        m.erase(handles[k]);
+        handles[k] = m.push_back("/scene/entity/" + ofToString(n + i), int(i));
+    }
+    uint64_t time = ofGetElapsedTimeMicros() - startTime;
+
+    outputStream << name << " n: " << n << " total: " << time << " per erase + insert: " << double(time) / numOps << endl;
+}
+
+
+// check that slot maps can be reused after being moved from, and that handles never alias across moves and assignments
+template<typename SlotMapType>
+void checkSlotMapMoves(string name) {
+    bool ok = true;
+    try {
+        SlotMapType a, b, c;
+        typename SlotMapType::Handle h = a.push_back("x", 1);
+        SlotMapType moved(std::move(a));
+        a.push_back("y", 2);    // reuse after being move constructed from
+        a.checkInvariants();
+        ok = ok && moved.exists(h) && !a.exists(h) && a["y"] == 2;
+
+        h = a.handleFor("y");
+        b = std::move(a);       // into a map which has never had items, so handles carry over
+        a.push_back("z", 3);    // reuse after being move assigned from
+        a.checkInvariants();
+        ok = ok && b.exists(h) && !a.exists(h) && a["z"] == 3;
+
+        h = a.handleFor("z");
+        c.push_back("c", 9);
+        a = c;                  // a's handles are stale, even though c has an item in the same slot
+        a.checkInvariants();
+        ok = ok && !a.exists(h) && a["c"] == 9;
+    } catch(...) {
+        ok = false;
+    }
+
+    outputStream << name << (ok ? " ok" : " FAILED: moved-from map or stale handles") << endl;
+    if(!ok) numFailures++;
+}
+
+
+// time reordering a map of n items: moving single items far and near (e.g. dragging in a list), moving a block, and swapping
+template<typename MapType>
+void benchmarkReorder(string name, int n, int numOps) {
+    vector<string> keys = makeKeys(n);
+    MapType m;
+    for(int i=0; i<n; i++) m.push_back(keys[i], i);
+
+    uint32_t seed = 1;
+    auto randomIndex = [&](int range) { seed = seed * 1664525 + 1013904223; return int(seed % range); };
+
+    uint64_t startTime = ofGetElapsedTimeMicros();
+    for(int i=0; i<numOps; i++) m.move(randomIndex(n), randomIndex(n));
+    uint64_t farTime = ofGetElapsedTimeMicros() - startTime;
+
+    startTime = ofGetElapsedTimeMicros();
+    for(int i=0; i<numOps; i++) {
+        int from = randomIndex(n - 10);
+        m.move(from, from + 1 + randomIndex(9));
+    }
+    uint64_t nearTime = ofGetElapsedTimeMicros() - startTime;
+
+    startTime = ofGetElapsedTimeMicros();
+    for(int i=0; i<numOps; i++) {
+        int first = randomIndex(n - 100);
+        m.moveRange(first, first + 100, randomIndex(n - 100));
+    }
+    uint64_t rangeTime = ofGetElapsedTimeMicros() - startTime;
+
+    startTime = ofGetElapsedTimeMicros();
+    for(int i=0; i<numOps; i++) m.swap(randomIndex(n), randomIndex(n));
+    uint64_t swapTime = ofGetElapsedTimeMicros() - startTime;
+
+    outputStream << name << " n: " << n << " per move (far): " << double(farTime) / numOps << " move (near): " << double(nearTime) / numOps
+                 << " moveRange (100 items): " << double(rangeTime) / numOps << " swap: " << double(swapTime) / numOps << endl;
+}
+
+
+// count allocations during lookups by key and index, which must be zero
+// and by string_view and const char*, which must be zero if the index can look them up without converting to a key
+// (see msa::KeyTraits, i.e. everything except HashIndex before C++20)
+template<typename MapType>
+void benchmarkAllocations(string name, bool viewsConvert = false) {
+    int n = 1000;
+    vector<string> keys = makeKeys(n);
+    MapType m;
+    for(int i=0; i<n; i++) m.push_back(keys[i], i);
+
+    uint64_t startAllocations = numAllocations;
+    int sum = 0;
+    for(int i=0; i<n; i++) {
+        sum += m.at(keys[i]);
+        sum += m[keys[i]];
+        sum += m.at(i);
+        sum += m[i];
+        sum += m.indexFor(keys[i]);
+        sum += m.exists(keys[i]);
+    }
+    uint64_t allocations = numAllocations - startAllocations;
+
+    startAllocations = numAllocations;
+    for(int i=0; i<n; i++) {
+        sum += m.at(string_view(keys[i]));
+        sum += m.exists(keys[i].c_str());
+    }
+    uint64_t viewAllocations = numAllocations - startAllocations;
+
+    outputStream << name << " allocations per lookup: " << double(allocations) / (n * 6)
+                 << " by string_view / const char*: " << double(viewAllocations) / (n * 2) << " (" << sum << ")" << endl;
+
+    if(allocations != 0 || (viewAllocations != 0 && !viewsConvert)) {
+        outputStream << name << " FAILED: lookups allocated" << endl;
+        numFailures++;
+    }
+}
+
+
+class ofApp : public ofBaseApp{
+public:
+
+    void tester() {
+        outputStream << "STARTING..." << endl << endl;
+
+        outputStream << "ERASE ONE AT A TIME" << endl;
+        benchmarkErase< msa::OrderedMap<string, int> >("MapIndex  ");
+        benchmarkErase< msa::OrderedMap<string, int, msa::HashIndex<string> > >("HashIndex ");
+        benchmarkErase< msa::OrderedMap<string, int, msa::FlatIndex<string> > >("FlatIndex ");
+
+        outputStream << "BULK LOAD" << endl;
+        benchmarkBulkLoad< msa::OrderedMap<string, int> >("MapIndex  ", 100000);
+        benchmarkBulkLoad< msa::OrderedMap<string, int, msa::HashIndex<string> > >("HashIndex ", 100000);
+        benchmarkBulkLoad< msa::OrderedMap<string, int, msa::FlatIndex<string> > >("FlatIndex ", 100000);
+        outputStream << endl;
+
+        outputStream << "MEMORY PER ITEM (key length ~32)" << endl;
+        benchmarkMemory< msa::OrderedMap<string, int> >("MapIndex  ", 100000);
+        benchmarkMemory< msa::OrderedMap<string, int, msa::HashIndex<string> > >("HashIndex ", 100000);
+        benchmarkMemory< msa::OrderedMap<string, int, msa::FlatIndex<string> > >("FlatIndex ", 100000);
+        outputStream << endl;
+
+        outputStream << "ITERATE" << endl;
+        benchmarkIterate< msa::OrderedMap<string, int, msa::FlatIndex<string> > >("DenseOrder", 1000000);
+        benchmarkIterate< msa::OrderedMap<string, int, msa::FlatIndex<string>, msa::TreeOrder> >("TreeOrder ", 1000000);
+        outputStream << endl;
+
+#ifdef MSA_ORDEREDMAP_PMR
+        outputStream << "MAPS REBUILT EVERY FRAME" << endl;
+        benchmarkFrameMaps< msa::OrderedMap<string, int>, msa::pmr::OrderedMap<std::pmr::string, int> >("MapIndex  ", 10000, 100);
+        benchmarkFrameMaps< msa::OrderedMap<string, int, msa::FlatIndex<string> >,
+                            msa::pmr::OrderedMap<std::pmr::string, int, msa::FlatIndex<std::pmr::string> > >("FlatIndex ", 10000, 100);
+        outputStream << endl;
+#endif
+
+        outputStream << "LOTS OF SMALL MAPS" << endl;
+        benchmarkSmallMaps< msa::OrderedMap<string, int> >("MapIndex  ");
+        benchmarkSmallMaps< msa::OrderedMap<string, int, msa::FlatIndex<string> > >("FlatIndex ");
+        benchmarkSmallMaps< msa::OrderedMap<string, int, msa::SmallIndex<string> > >("SmallIndex");
+#ifdef MSA_ORDEREDMAP_PMR
+        benchmarkSmallMaps< msa::SmallOrderedMap<string, int> >("SmallOrderedMap", true);
+#endif
+        outputStream << endl;
+
+        outputStream << "LOTS OF MAPS WITH THE SAME KEYS" << endl;
+        benchmarkSharedKeys< msa::OrderedMap<string, int, msa::FlatIndex<string> > >("string keys        ", 10000, 32);
+        benchmarkSharedKeys< msa::OrderedMap<msa::InternedString, int, msa::FlatIndex<msa::InternedString> > >("InternedString keys", 10000, 32);
+        outputStream << endl;
+
+        outputStream << "INSERT / ERASE CHURN" << endl;
+        benchmarkChurn< msa::MapIndex<long> >("MapIndex ");
+        benchmarkChurn< msa::HashIndex<long> >("HashIndex");
+        outputStream << endl;
+
+        outputStream << "SAME NAMES EVERY FRAME" << endl;
+        benchmarkTokens< msa::OrderedMap<string, int> >("MapIndex  ", 100000, 200, 10000);
+        benchmarkTokens< msa::OrderedMap<string, int, msa::HashIndex<string> > >("HashIndex ", 100000, 200, 10000);
+        benchmarkTokens< msa::OrderedMap<string, int, msa::FlatIndex<string> > >("FlatIndex ", 100000, 200, 10000);
+        outputStream << endl;
+
+        outputStream << "REGISTRY (ERASE ANYWHERE, ADD AT THE END)" << endl;
+        benchmarkRegistry< msa::OrderedMap<string, int, msa::FlatIndex<string> > >("OrderedMap DenseOrder    ", 100000, 10000);
+        benchmarkRegistry< msa::OrderedMap<string, int, msa::FlatIndex<string>, msa::TreeOrder> >("OrderedMap TreeOrder     ", 100000, 10000);
+        benchmarkSlotMapRegistry< msa::OrderedSlotMap<string, int> >("OrderedSlotMap           ", 100000, 10000);
+        outputStream << endl;
+
+        outputStream << "MOVES AND ASSIGNMENTS" << endl;
+        checkSlotMapMoves< msa::OrderedSlotMap<string, int> >("OrderedSlotMap FlatIndex ");
+        checkSlotMapMoves< msa::OrderedSlotMap<string, int, msa::MapIndex<string> > >("OrderedSlotMap MapIndex  ");
+        checkSlotMapMoves< msa::OrderedSlotMap<string, int, msa::HashIndex<string> > >("OrderedSlotMap HashIndex ");
+        outputStream << endl;
+
+        outputStream << "ALLOCATIONS (MSA_ORDEREDMAP_CHECKS " << (MSA_ORDEREDMAP_CHECKS ? "on" : "off") << ")" << endl;
+        benchmarkAllocations< msa::OrderedMap<string, int> >("MapIndex  ");
+        benchmarkAllocations< msa::OrderedMap<string, int, msa::HashIndex<string> > >("HashIndex ", !MSA_ORDEREDMAP_UNORDERED_TRANSPARENT);
+        benchmarkAllocations< msa::OrderedMap<string, int, msa::FlatIndex<string> > >("FlatIndex ");
+        benchmarkAllocations< msa::OrderedMap<string, int, msa::FlatIndex<string>, msa::TreeOrder> >("TreeOrder ");
+        outputStream << endl;
+
+        outputStream << "REORDER" << endl;
+        benchmarkReorder< msa::OrderedMap<string, int, msa::FlatIndex<string> > >("DenseOrder", 100000, 1000);
+        benchmarkReorder< msa::OrderedMap<string, int, msa::FlatIndex<string>, msa::TreeOrder> >("TreeOrder ", 100000, 1000);
+        outputStream << endl;
+
+        outputStream << "INSERT / ERASE IN THE MIDDLE" << endl;
+        benchmarkMiddleEdits< msa::OrderedMap<string, int, msa::FlatIndex<string> > >("DenseOrder");
+        benchmarkMiddleEdits< msa::OrderedMap<string, int, msa::FlatIndex<string>, msa::TreeOrder> >("TreeOrder ");
+
+        outputStream << endl << "ENDING..." << endl << endl;
+    }
+
+    //--------------------------------------------------------------
+    void setup() {
+        tester();
+        cout << outputStream.str();
+        if(numFailures) {
+            cerr << numFailures << " checks FAILED" << endl;
+            ofExit(1);
+        }
+    }
+
+    //--------------------------------------------------------------
+    void draw() {
+        ofBackground(0);
+        ofDrawBitmapString(outputStream.str(), 20, 30);
+    }
+
+};
+
+//========================================================================
+int main( ){
+    ofSetupOpenGL(1024, 800, OF_WINDOW);			// <-------- setup the GL context
+    ofRunApp( new ofApp());
+}
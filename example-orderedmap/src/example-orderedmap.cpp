@@ -64,8 +64,8 @@ public:
         outputStream << "pearl - " << myContainer["pearl"]->toString() << endl;
         outputStream << "bruce - " << myContainer["bruce"]->toString() << endl;
 
-        // i know this one doesn't exist, so checking first to avoid an exception
-        if(myContainer.exists("blufo")) outputStream << "blufo - " << myContainer["blufo"]->toString() << endl;
+        // i know this one doesn't exist, so using find (which returns NULL instead of throwing an exception)
+        if(auto blufo = myContainer.find("blufo")) outputStream << "blufo - " << (*blufo)->toString() << endl;
         else outputStream << "blufo doesn't exist!" << endl;
 
 
@@ -99,15 +99,16 @@ public:
         // erase by index
         outputStream << endl << endl << "erase by index... erase(1)" << endl;
         myContainer.erase(1); // erasing jane
-        for(int i=0; i<myContainer.size(); i++) {
-            outputStream << myContainer.keyFor(i) << " - " << myContainer[i]->toString() << endl;
+        // iterating in order (key and item references, no lookups)
+        for(auto&& [key, person] : myContainer) {
+            outputStream << key << " - " << person->toString() << endl;
         }
 
         // erase by key
         outputStream << endl << endl << "erase by key... erase('bruce') " << endl;
         myContainer.erase("bruce"); // erasing bruce
-        for(int i=0; i<myContainer.size(); i++) {
-            outputStream << myContainer.keyFor(i) << " - " << myContainer[i]->toString() << endl;
+        for(auto&& [key, person] : myContainer) {
+            outputStream << key << " - " << person->toString() << endl;
         }
 
 
@@ -115,8 +116,8 @@ public:
         outputStream << endl << endl << "change key..." << endl;
         myContainer.changeKey(0, "mehmet");
         myContainer.changeKey("pearl", "pearlikens");
-        for(int i=0; i<myContainer.size(); i++) {
-            outputStream << myContainer.keyFor(i) << " - " << myContainer[i]->toString() << endl;
+        for(auto&& [key, person] : myContainer) {
+            outputStream << key << " - " << person->toString() << endl;
         }
 
         outputStream << endl << "ENDING..." << endl << endl;
@@ -0,0 +1,176 @@
+//                                      __
+//     ____ ___  ___  ____ ___  ____   / /__   __
+//    / __ `__ \/ _ \/ __ `__ \/ __ \ / __/ | / /
+//   / / / / / /  __/ / / / / / /_/ // /_ | |/ /
+//  /_/ /_/ /_/\___/_/ /_/ /_/\____(_)__/ |___/
+//
+//
+//  Created by Memo Akten, www.memo.tv
+//
+//  interned strings, for OrderedMaps which share the same key vocabulary (e.g. "position", "color", "scale"...)
+//  msa::OrderedMap<msa::InternedString, T, msa::FlatIndex<msa::InternedString> > myContainer;
+//
+//  each distinct string is stored once, in a shared append-only pool, and an InternedString is just a pointer to it
+//  so keys cost a pointer per entry, and comparing or hashing them doesn't touch the characters
+//  looking up by string, string_view or const char* (e.g. at("position")) doesn't add anything to the pool,
+//  only adding keys (e.g. push_back("position", t)) does. strings are never removed from the pool
+//
+
+#pragma once
+
+#include "ofxMSAOrderedMap.h"
+#include <deque>
+#include <mutex>
+
+namespace msa {
+
+//--------------------------------------------------------------
+// the pool of interned strings, shared by all InternedStrings (and threads)
+class StringPool {
+public:
+    struct Entry {
+        string str;
+        size_t hash;    // hash<string_view> of str, the same as hashing the characters
+    };
+
+    static StringPool& shared();
+
+    const Entry* intern(string_view s);     // adds s to the pool if it isn't there yet
+    const Entry* find(string_view s) const; // NULL if s isn't in the pool
+    const Entry* empty() const { return _empty; }
+    const Entry* missing() const { return &_missing; }  // not in the pool, so never equal to an interned string
+    int size() const;
+
+private:
+    mutable mutex _mutex;
+    deque<Entry> _entries;  // never moves entries as it grows
+    unordered_map<string_view, const Entry*> _lookup;   // views into the entries
+    const Entry* _empty;
+    Entry _missing;
+
+    StringPool();
+};
+
+
+//--------------------------------------------------------------
+class InternedString {
+public:
+    InternedString() : _entry(StringPool::shared().empty()) {}
+    InternedString(const string& s) : _entry(StringPool::shared().intern(s)) {}
+    InternedString(const char* s) : _entry(StringPool::shared().intern(s)) {}
+    explicit InternedString(string_view s) : _entry(StringPool::shared().intern(s)) {}
+
+    // s if it's already interned, otherwise a string which doesn't equal any other (doesn't add s to the pool)
+    static InternedString lookup(string_view s);
+
+    const string& str() const { return _entry->str; }
+    size_t hash() const { return _entry->hash; }
+
+    // the same string is always the same entry, so these don't compare characters
+    bool operator==(const InternedString& other) const { return _entry == other._entry; }
+    bool operator!=(const InternedString& other) const { return _entry != other._entry; }
+
+    // in alphabetical order (like string)
+    bool operator<(const InternedString& other) const { return _entry != other._entry && _entry->str < other._entry->str; }
+
+    // comparisons with anything string like, which don't intern it
+    template<typename K> using IfStringLike = typename enable_if<is_convertible<const K&, string_view>::value, bool>::type;
+    template<typename K> friend IfStringLike<K> operator==(const InternedString& a, const K& b) { return string_view(a.str()) == string_view(b); }
+    template<typename K> friend IfStringLike<K> operator==(const K& a, const InternedString& b) { return string_view(a) == string_view(b.str()); }
+    template<typename K> friend IfStringLike<K> operator!=(const InternedString& a, const K& b) { return !(a == b); }
+    template<typename K> friend IfStringLike<K> operator!=(const K& a, const InternedString& b) { return !(a == b); }
+    template<typename K> friend IfStringLike<K> operator<(const InternedString& a, const K& b) { return string_view(a.str()) < string_view(b); }
+    template<typename K> friend IfStringLike<K> operator<(const K& a, const InternedString& b) { return string_view(a) < string_view(b.str()); }
+
+    friend ostream& operator<<(ostream& os, const InternedString& s) { return os << s.str(); }
+
+private:
+    const StringPool::Entry* _entry;
+
+    explicit InternedString(const StringPool::Entry* entry) : _entry(entry) {}
+};
+
+
+//--------------------------------------------------------------
+// hashes the same as the characters, so lookups by string_view or const char* find interned keys
+struct InternedStringHash {
+    typedef void is_transparent;
+    size_t operator()(const InternedString& s) const { return s.hash(); }
+    template<typename K> size_t operator()(const K& s) const { return hash<string_view>()(string_view(s)); }
+};
+
+// indices which can't look up string_views directly (i.e. HashIndex before C++20) convert them without interning
+template<>
+struct KeyConverter<InternedString> {
+    template<typename K> static InternedString lookupKey(const K& key) { return InternedString::lookup(string_view(key)); }
+};
+
+// default comparison and hashing for InternedString keys, all transparent (see KeyTraits)
+template<>
+struct KeyTraits<InternedString> {
+    typedef less<> Compare;
+    typedef InternedStringHash Hash;
+    typedef equal_to<> KeyEqual;
+};
+
+
+
+//--------------------------------------------------------------
+// StringPool implementation
+//--------------------------------------------------------------
+inline StringPool& StringPool::shared() {
+    static StringPool pool;
+    return pool;
+}
+
+//--------------------------------------------------------------
+inline StringPool::StringPool() : _missing{ string(), 0 } {
+    _entries.push_back(Entry{ string(), hash<string_view>()(string_view()) });
+    _empty = &_entries.back();
+    _lookup[_empty->str] = _empty;
+}
+
+//--------------------------------------------------------------
+inline const StringPool::Entry* StringPool::intern(string_view s) {
+    lock_guard<mutex> lock(_mutex);
+    auto it = _lookup.find(s);
+    if(it != _lookup.end()) return it->second;
+
+    _entries.push_back(Entry{ string(s), hash<string_view>()(s) });
+    const Entry* entry = &_entries.back();
+    _lookup[entry->str] = entry;
+    return entry;
+}
+
+//--------------------------------------------------------------
+inline const StringPool::Entry* StringPool::find(string_view s) const {
+    lock_guard<mutex> lock(_mutex);
+    auto it = _lookup.find(s);
+    return it == _lookup.end() ? NULL : it->second;
+}
+
+//--------------------------------------------------------------
+inline int StringPool::size() const {
+    lock_guard<mutex> lock(_mutex);
+    return _entries.size();
+}
+
+
+//--------------------------------------------------------------
+// InternedString implementation
+//--------------------------------------------------------------
+inline InternedString InternedString::lookup(string_view s) {
+    const StringPool::Entry* entry = StringPool::shared().find(s);
+    return InternedString(entry ? entry : StringPool::shared().missing());
+}
+
+}
+
+
+// so InternedStrings can go in other hashed containers too
+namespace std {
+template<>
+struct hash<msa::InternedString> {
+    size_t operator()(const msa::InternedString& s) const { return s.hash(); }
+};
+}
@@ -9,29 +9,618 @@
 //
 //  acts like a std::map, but preserves order of insertion
 //  I use this now with std::shared_ptr instead of ofxMSAOrderedPointerMap
+//  but T can also be move-only (e.g. std::unique_ptr) and doesn't need a default constructor, so objects can be stored directly
 //
 
 #pragma once
 
 #include "ofMain.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <string_view>
+#include <type_traits>
+#include <limits>
+#include <cstdint>
+#include <cassert>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define MSA_ORDEREDMAP_PMR
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MSA_ORDEREDMAP_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// MSA_ORDEREDMAP_CHECKS enables validation of indices and keys passed in (throwing exceptions if they don't exist),
+// and internal sanity checks on every size() call. on by default in debug builds, off in release builds (NDEBUG)
+// with checks off, like std::vector::operator[], using an index or key which doesn't exist is undefined behaviour
+// (checkInvariants() is always available)
+#ifndef MSA_ORDEREDMAP_CHECKS
+#ifdef NDEBUG
+#define MSA_ORDEREDMAP_CHECKS 0
+#else
+#define MSA_ORDEREDMAP_CHECKS 1
+#endif
+#endif
 
 namespace msa {
 
-template<typename keyType, typename T>
+//--------------------------------------------------------------
+// key index policies
+// an index maps each key to the slot of its item in the OrderedMap (find returns -ve if the key doesn't exist)
+// (the slot is the same as the item's index, unless erased items have been left as tombstones, see below)
+// keys is the OrderedMap's vector of keys (KeyVector), the only copy of each key: indices refer to them by slot
+// insert only adds the key if it doesn't exist yet (returning the existing slot if it does, -ve otherwise),
+// with a single lookup. the key is already in keys at the slot it's added with. it sets a handle to the new entry, which the OrderedMap stores alongside the key,
+// so that entries can be updated without looking the key up again (erase may still look it up, e.g. StdMapIndex finds its entry by slot)
+// reserve makes room for n entries without rehashing, capacity is how many entries fit, shrink_to_fit releases unused memory
+// rename changes the key of an existing entry (and its handle), unless the new key exists (returning its slot, -ve otherwise)
+// MapIndex (default) uses an stl::map, i.e. O(log n) lookups with operator< (or a custom Compare)
+// HashIndex uses an stl::unordered_map, i.e. O(1) lookups with std::hash (or a custom Hash and KeyEqual)
+// FlatIndex is an open addressing hash table which only stores (fingerprint, index) pairs, see below
+// SmallIndex finds keys with a linear scan (allocating nothing) until the map grows past N keys, then becomes a FlatIndex
+// (SmallOrderedMap also keeps the map's own vectors inline, so small maps don't allocate at all)
+// if an index is transparent, find also takes other types which can be compared with keys directly (e.g. string_view)
+// rebind<Allocator> is the same index allocating with Allocator (the OrderedMap's allocator, see below)
+
+// default comparison and hashing for keys
+// for string keys these are transparent, so that looking up a string_view or const char* (e.g. at("blufo"))
+// doesn't construct a temporary string, which allocates for longer keys
+template<typename keyType>
+struct KeyTraits {
+    typedef less<keyType> Compare;
+    typedef hash<keyType> Hash;
+    typedef equal_to<keyType> KeyEqual;
+};
+
+struct StringHash {
+    typedef void is_transparent;
+    size_t operator()(string_view s) const { return hash<string_view>()(s); }
+};
+
+template<typename StringAllocator>
+struct KeyTraits< basic_string<char, char_traits<char>, StringAllocator> > {   // string and pmr::string
+    typedef less<> Compare;
+    typedef StringHash Hash;
+    typedef equal_to<> KeyEqual;
+};
+
+// converts another type to a key, for indices which can't look it up directly (see convertKeys below)
+// specialize this if constructing a key has side effects (e.g. InternedString)
+template<typename keyType>
+struct KeyConverter {
+    template<typename K> static keyType lookupKey(const K& key) { return keyType(key); }
+};
+
+// whether a comparison or hash function is transparent (i.e. has is_transparent)
+template<typename F, typename = void> struct isTransparent : false_type {};
+template<typename F> struct isTransparent<F, void_t<typename F::is_transparent> > : true_type {};
+
+// whether a container has buckets to reserve (i.e. is an unordered_map)
+template<typename C, typename = void> struct hasBuckets : false_type {};
+template<typename C> struct hasBuckets<C, void_t<decltype(declval<C&>().bucket_count())> > : true_type {};
+
+// a vector of T allocating with (a rebound) Allocator
+template<typename T, typename Allocator>
+using VectorFor = vector<T, typename allocator_traits<Allocator>::template rebind_alloc<T> >;
+
+// the same map type allocating with (a rebound) Allocator
+template<typename mapType, typename Allocator> struct rebindMap;
+
+template<typename K, typename V, typename Compare, typename A, typename Allocator>
+struct rebindMap<map<K, V, Compare, A>, Allocator> {
+    typedef map<K, V, Compare, typename allocator_traits<Allocator>::template rebind_alloc< pair<const K, V> > > type;
+};
+
+template<typename K, typename V, typename Hash, typename KeyEqual, typename A, typename Allocator>
+struct rebindMap<unordered_map<K, V, Hash, KeyEqual, A>, Allocator> {
+    typedef unordered_map<K, V, Hash, KeyEqual, typename allocator_traits<Allocator>::template rebind_alloc< pair<const K, V> > > type;
+};
+
+
+// unordered_map only has heterogeneous lookup from C++20, before that other types still work but are converted to keyType
+#ifdef __cpp_lib_generic_unordered_lookup
+#define MSA_ORDEREDMAP_UNORDERED_TRANSPARENT 1
+#else
+#define MSA_ORDEREDMAP_UNORDERED_TRANSPARENT 0
+#endif
+
+// an entry in a StdMapIndex: the slot of a key in the OrderedMap's vector of keys, rather than a copy of the key
+// the slot is updated in place when the item moves slots, which doesn't change where the entry belongs in the set
+struct KeySlot {
+    enum { kProbe = -1, kNewKey = -2 };    // a KeyProbe (see below), and an entry whose key isn't in the keys yet
+    mutable int slot;
+};
+
+// a key being looked up, passed to the set in place of a KeySlot. it brings the keys along with it,
+// so looking up doesn't change anything in the index (and is safe from several threads)
+template<typename K, typename KeyVector>
+struct KeyProbe : KeySlot {
+    const K* key;
+    const KeyVector* keys;
+};
+
+// the keys which the entries of a StdMapIndex refer to, set by each call which changes the set
+// it's owned by the index (so it stays put when the index moves), and the set's comparison functions point at it
+template<typename KeyVector>
+struct KeySlotKeys {
+    typedef typename KeyVector::value_type keyType;
+    const KeyVector* keys = NULL;
+    const keyType* newKey = NULL;   // the key of the kNewKey entry
+};
+
+// applies a comparison or hash function F to the keys of KeySlots and KeyProbes
+// comparing with a probe takes the keys from the probe, so only changes to the set use the index's keys
+// without heterogeneous lookup (slotProbes), a probe for a keyType is passed as a KeySlot, so it's told apart by its slot
+template<typename F, typename KeyVector, bool slotProbes = false>
+struct OnKeySlots {
+    typedef void is_transparent;
+    typedef KeySlotKeys<KeyVector> Keys;
+    typedef typename Keys::keyType keyType;
+
+    F f;
+    const Keys* keys;
+
+    template<typename A> auto operator()(const A& a) const { return f(keyOf(a, NULL)); }
+    template<typename A, typename B> auto operator()(const A& a, const B& b) const {
+        const KeyVector* probeKeys = keysOf(a) ? keysOf(a) : keysOf(b);
+        return f(keyOf(a, probeKeys), keyOf(b, probeKeys));
+    }
+
+    static bool isProbe(const KeySlot& k) { return slotProbes && k.slot == KeySlot::kProbe; }
+    static const KeyProbe<keyType, KeyVector>& probe(const KeySlot& k) { return static_cast<const KeyProbe<keyType, KeyVector>&>(k); }
+    static const KeyVector* keysOf(const KeySlot& k) { return isProbe(k) ? probe(k).keys : NULL; }
+    template<typename K> static const KeyVector* keysOf(const KeyProbe<K, KeyVector>& k) { return k.keys; }
+
+    const keyType& keyOf(const KeySlot& k, const KeyVector* probeKeys) const {
+        if(isProbe(k)) return *probe(k).key;
+        if(k.slot == KeySlot::kNewKey) {
+            assert(keys->newKey);
+            return *keys->newKey;
+        }
+        const KeyVector* slotKeys = probeKeys ? probeKeys : keys->keys;
+        assert(slotKeys && k.slot >= 0 && k.slot < int(slotKeys->size()));
+        return (*slotKeys)[k.slot];
+    }
+    template<typename K> static const K& keyOf(const KeyProbe<K, KeyVector>& k, const KeyVector*) { return *k.key; }
+};
+
+// the set of KeySlots which a StdMapIndex keeps in place of mapType, with the same comparison or hashing and allocator
+template<typename mapType> struct keySlotSet;
+
+template<typename K, typename V, typename Compare, typename A>
+struct keySlotSet< map<K, V, Compare, A> > {
+    typedef VectorFor<K, A> KeyVector;
+    typedef set<KeySlot, OnKeySlots<Compare, KeyVector>, typename allocator_traits<A>::template rebind_alloc<KeySlot> > type;
+};
+
+template<typename K, typename V, typename Hash, typename KeyEqual, typename A>
+struct keySlotSet< unordered_map<K, V, Hash, KeyEqual, A> > {
+    typedef VectorFor<K, A> KeyVector;
+    static const bool slotProbes = !MSA_ORDEREDMAP_UNORDERED_TRANSPARENT;
+    typedef unordered_set<KeySlot, OnKeySlots<Hash, KeyVector, slotProbes>, OnKeySlots<KeyEqual, KeyVector, slotProbes>,
+                          typename allocator_traits<A>::template rebind_alloc<KeySlot> > type;
+};
+
+
+// mapType is the map to index keys with (a map or unordered_map to int), but only its comparison or hashing
+// and allocator are used: each key is only stored once, in the OrderedMap, and the index is a set of KeySlots
+// if convertKeys is set, other types are converted to keyType before the lookup (see HashIndex below)
+template<typename mapType, bool transparentLookup = false, bool convertKeys = false>
+class StdMapIndex {
+public:
+    typedef typename mapType::key_type keyType;
+    typedef const KeySlot* handle;      // set nodes don't move, even when an unordered_set rehashes
+    typedef typename keySlotSet<mapType>::KeyVector KeyVector;
+    static const bool transparent = transparentLookup;
+
+    template<typename Allocator> using rebind = StdMapIndex<typename rebindMap<mapType, Allocator>::type, transparentLookup, convertKeys>;
+
+    StdMapIndex() : StdMapIndex(SetAllocator()) {}
+    template<typename Allocator> explicit StdMapIndex(const Allocator& allocator)
+        : _keys(newKeys(SetAllocator(allocator))), _set(newSet(_keys, SetAllocator(allocator))) {}
+    StdMapIndex(StdMapIndex&& other);
+    StdMapIndex& operator=(StdMapIndex&& other);
+    ~StdMapIndex() { deleteKeys(); }
+
+    int size() const { return _set.size(); }
+    void clear() { _set.clear(); }
+
+    // a set allocates per node, so only an unordered_set has anything to reserve
+    void reserve(int n, const KeyVector& keys) {
+        if constexpr(hasBuckets<SetType>::value) { _keys->keys = &keys; _set.reserve(n); }
+    }
+    int capacity() const {
+        if constexpr(hasBuckets<SetType>::value) return _set.bucket_count() * _set.max_load_factor();
+        else return numeric_limits<int>::max();
+    }
+    void shrink_to_fit(const KeyVector& keys) {
+        if constexpr(hasBuckets<SetType>::value) { _keys->keys = &keys; _set.rehash(0); }
+    }
+    template<typename K> int find(const K& key, const KeyVector& keys) const {
+        if constexpr(convertKeys && !is_same<K, keyType>::value) {
+            return find(KeyConverter<keyType>::lookupKey(key), keys);
+        } else {
+            auto it = _set.find(KeyProbe<K, KeyVector>{ { KeySlot::kProbe }, &key, &keys });
+            return it == _set.end() ? -1 : it->slot;
+        }
+    }
+    int insert(const keyType& /*key*/, int index, const KeyVector& keys, handle& h) {
+        _keys->keys = &keys;
+        auto result = _set.insert(KeySlot{ index });
+        if(!result.second) return result.first->slot;
+        h = &*result.first;
+        return -1;
+    }
+    void erase(handle /*h*/, int index, const KeyVector& keys) {
+        _keys->keys = &keys;
+        _set.erase(findEntry(index, keys));
+    }
+    void setIndex(handle h, int /*oldIndex*/, int newIndex) { h->slot = newIndex; }
+    int rename(handle& h, int index, const keyType& newKey, const KeyVector& keys) {
+        int existingIndex = find(newKey, keys);
+        if(existingIndex >= 0) return existingIndex;
+        _keys->keys = &keys;
+        _keys->newKey = &newKey;
+        typename SetType::iterator position;
+        if constexpr(is_trivially_destructible<SetAllocator>::value) {
+            // move the node itself to the new key's place, so nothing is reallocated
+            auto node = _set.extract(findEntry(index, keys));
+            node.value().slot = KeySlot::kNewKey;
+            position = _set.insert(std::move(node)).position;
+        } else {
+            // libstdc++ (at least up to 12) never destroys the allocator in a node handle which is inserted,
+            // which would leak e.g. the pools of a PoolAllocator, so add a new node before erasing the old one
+            position = _set.insert(KeySlot{ KeySlot::kNewKey }).first;
+            _set.erase(findEntry(index, keys));
+        }
+        position->slot = index;
+        _keys->newKey = NULL;
+        h = &*position;
+        return -1;
+    }
+
+private:
+    typedef typename keySlotSet<mapType>::type SetType;
+    typedef typename SetType::allocator_type SetAllocator;
+    typedef KeySlotKeys<KeyVector> Keys;
+    typedef typename allocator_traits<SetAllocator>::template rebind_alloc<Keys> KeysAllocator;
+
+    Keys* _keys;            // allocated with the set's allocator
+    SetType _set;
+
+    // the entry for the key in slot index, which must exist
+    typename SetType::const_iterator findEntry(int index, const KeyVector& keys) const {
+        return _set.find(KeyProbe<keyType, KeyVector>{ { KeySlot::kProbe }, &keys[index], &keys });
+    }
+
+    static Keys* newKeys(const SetAllocator& allocator);
+    void deleteKeys();
+    static SetType newSet(const Keys* keys, const SetAllocator& allocator);
+};
+
+template<typename keyType, typename Compare = typename KeyTraits<keyType>::Compare>
+using MapIndex = StdMapIndex< map<keyType, int, Compare>, isTransparent<Compare>::value>;
+
+template<typename keyType, typename Hash = typename KeyTraits<keyType>::Hash, typename KeyEqual = typename KeyTraits<keyType>::KeyEqual>
+using HashIndex = StdMapIndex< unordered_map<keyType, int, Hash, KeyEqual>,
+    isTransparent<Hash>::value && isTransparent<KeyEqual>::value, !MSA_ORDEREDMAP_UNORDERED_TRANSPARENT>;
+
+
+//--------------------------------------------------------------
+// FlatIndex: swiss table style open addressing hash index
+// the keys themselves aren't stored (the OrderedMap already has them), only a flat array of item indices,
+// with a control byte per slot holding a 7 bit fingerprint of the hash (or empty / deleted)
+// slots are probed in groups of 16, comparing all 16 control bytes at once with SSE2 (if available)
+// because item indices are unique, an existing entry can be located from its hash and index alone (no key compares),
+// so the handle is simply the hash
+template<typename keyType, typename Hash = typename KeyTraits<keyType>::Hash, typename KeyEqual = typename KeyTraits<keyType>::KeyEqual,
+         typename Allocator = allocator<int> >
+class FlatIndex {
+public:
+    typedef size_t handle;
+    typedef VectorFor<keyType, Allocator> KeyVector;
+    static const bool transparent = isTransparent<Hash>::value && isTransparent<KeyEqual>::value;
+
+    template<typename OtherAllocator> using rebind = FlatIndex<keyType, Hash, KeyEqual, OtherAllocator>;
+
+    explicit FlatIndex(const Allocator& allocator = Allocator()) : _ctrl(allocator), _slots(allocator), _size(0), _deleted(0) {}
+
+    // a moved-from index is empty (the implicit moves would leave it with a size but no table)
+    FlatIndex(const FlatIndex& other) = default;
+    FlatIndex(FlatIndex&& other);
+    FlatIndex& operator=(const FlatIndex& other) = default;
+    FlatIndex& operator=(FlatIndex&& other);
+
+    int size() const;
+    void clear();
+    void reserve(int n, const KeyVector& keys);
+    int capacity() const { return _ctrl.size() * 7 / 8; }
+    void shrink_to_fit(const KeyVector& keys);
+    template<typename K> int find(const K& key, const KeyVector& keys) const;
+    int insert(const keyType& key, int index, const KeyVector& keys, handle& h);
+    void erase(handle h, int index, const KeyVector& keys);
+    void setIndex(handle h, int oldIndex, int newIndex);
+    int rename(handle& h, int index, const keyType& newKey, const KeyVector& keys);
+
+    template<typename K> size_t hashFor(const K& key) const;    // i.e. the handle for a key
+
+private:
+    enum { kGroupSize = 16, kEmpty = -128, kDeleted = -2 };    // full slots have a control byte of 0..127
+
+    VectorFor<int8_t, Allocator> _ctrl;     // control byte per slot
+    VectorFor<int, Allocator> _slots;       // item index per slot
+    int _size;              // number of full slots
+    int _deleted;           // number of deleted slots (tombstones), these still count towards the load
+    Hash _hash;
+    KeyEqual _equal;
+
+    static int8_t fingerprint(size_t h) { return int8_t(h >> (sizeof(size_t) * 8 - 7)); }
+    size_t groupMask() const { return _ctrl.size() / kGroupSize - 1; }
+
+    // bitmasks of slots in the group (at ctrl) matching a fingerprint, which are empty, and which are empty or deleted
+    static uint32_t matchGroup(const int8_t* ctrl, int8_t fp);
+    static uint32_t matchEmpty(const int8_t* ctrl);
+    static uint32_t matchFree(const int8_t* ctrl);
+    static int lowestBit(uint32_t mask);
+
+    template<typename K> int findHashed(size_t h, const K& key, const KeyVector& keys) const;
+    int findSlot(size_t h, int index) const;    // slot holding index (it must exist)
+    void insertSlot(size_t h, int index);       // doesn't check load or existing keys
+    static size_t numSlotsFor(int n);           // smallest table which holds n entries
+    void rehash(size_t numSlots, const KeyVector& keys);
+    void release();                             // empty with no table, like a new index (keeping any capacity)
+};
+
+
+//--------------------------------------------------------------
+// SmallIndex: for small maps, the slots of up to N keys are kept inline and found with a linear scan of the keys,
+// so the index doesn't allocate anything. when the map grows past N keys, they all go into a FlatIndex instead
+// (and stay there until the map is cleared). the handles are always FlatIndex handles, so switching needs no handle updates
+// NOTE: this is only the index, the map's vectors of keys, items and handles still allocate (see SmallOrderedMap below)
+template<typename keyType, int N = 16, typename Hash = typename KeyTraits<keyType>::Hash, typename KeyEqual = typename KeyTraits<keyType>::KeyEqual,
+         typename Allocator = allocator<int> >
+class SmallIndex {
+public:
+    typedef FlatIndex<keyType, Hash, KeyEqual, Allocator> LargeIndex;
+    typedef typename LargeIndex::handle handle;
+    typedef typename LargeIndex::KeyVector KeyVector;
+    static const bool transparent = LargeIndex::transparent;
+
+    template<typename OtherAllocator> using rebind = SmallIndex<keyType, N, Hash, KeyEqual, OtherAllocator>;
+
+    explicit SmallIndex(const Allocator& allocator = Allocator()) : _large(allocator), _numSmall(0), _isLarge(false) {}
+
+    // a moved-from index is empty
+    SmallIndex(const SmallIndex& other) = default;
+    SmallIndex(SmallIndex&& other);
+    SmallIndex& operator=(const SmallIndex& other) = default;
+    SmallIndex& operator=(SmallIndex&& other);
+
+    int size() const                    { return _isLarge ? _large.size() : _numSmall; }
+    void clear()                        { _large.clear(); _numSmall = 0; _isLarge = false; }
+    void reserve(int n, const KeyVector& keys);
+    int capacity() const                { return _isLarge ? _large.capacity() : N; }
+    void shrink_to_fit(const KeyVector& keys) { _large.shrink_to_fit(keys); }
+    template<typename K> int find(const K& key, const KeyVector& keys) const;
+    int insert(const keyType& key, int index, const KeyVector& keys, handle& h);
+    void erase(handle h, int index, const KeyVector& keys);
+    void setIndex(handle h, int oldIndex, int newIndex);
+    int rename(handle& h, int index, const keyType& newKey, const KeyVector& keys);
+
+private:
+    LargeIndex _large;
+    int _small[N];          // slots of the keys while there are up to N
+    int _numSmall;
+    bool _isLarge;
+    KeyEqual _equal;
+
+    int smallPosition(int index) const; // position of index in _small
+    void makeLarge(const KeyVector& keys);
+};
+
+//--------------------------------------------------------------
+// order policies
+// an order keeps track of which storage slot holds the item at each index, so that the key index can point at slots
+// DenseOrder (default) keeps items in slots in order, so at(int) is a plain array read, but inserting or erasing
+// anywhere other than the end is O(n). erased slots can be left as tombstones (see OrderedMap::setCompactionThreshold),
+// which are tracked with a fenwick tree of live slots so index <-> slot is O(log n) while there are tombstones
+// TreeOrder keeps the order in a tree of slots (an implicit treap), so at(int), indexFor(), insertAt() and erase()
+// are all O(log n) regardless of position, and items never move slots. erased slots are reused by new items
+// orders with stableSlots also reorder items themselves with move(first, last, dest) (see OrderedMap::moveRange)
+// (both are typedefs of templates on the allocator, rebind<Allocator> is the same order allocating with Allocator)
+template<typename Allocator = allocator<int> >
+class BasicDenseOrder {
+public:
+    static const bool stableSlots = false;  // items move slots when other items are inserted or erased
+
+    template<typename OtherAllocator> using rebind = BasicDenseOrder<OtherAllocator>;
+
+    explicit BasicDenseOrder(const Allocator& allocator = Allocator()) : _erased(allocator), _tree(allocator), _numErased(0) {}
+
+    int numFree() const { return _numErased; }  // number of slots not holding an item
+    void clear();
+    void reserve(int numSlots);
+    void shrink_to_fit();
+
+    int slotFor(int index) const        { return _numErased == 0 ? index : select(index); }
+    int indexForSlot(int slot) const    { return _numErased == 0 ? slot : rank(slot); }
+    int nextSlot(int slot, int numSlots) const; // slot of the next / previous item in order, -ve if there isn't one
+    int prevSlot(int slot) const;
+
+    int insert(int index, int numSlots);    // slot for a new item at index (before the end only if there are no tombstones)
+    void erase(int slot, int numSlots);     // mark slot as erased (a tombstone)
+    bool isFree(int slot) const         { return _numErased != 0 && _erased[slot]; }
+    void truncate(int numSlots);            // remove all slots from numSlots onwards
+
+private:
+    VectorFor<char, Allocator> _erased;     // flag per slot, nothing is allocated until the first tombstone
+    VectorFor<int, Allocator> _tree;        // fenwick tree of live slots (1 based)
+    int _numErased;
+
+    int rank(int slot) const;           // number of live slots before slot, i.e. index of the item in slot
+    int select(int index) const;        // slot of the item at index
+};
+
+typedef BasicDenseOrder<> DenseOrder;
+
+
+template<typename Allocator = allocator<int> >
+class BasicTreeOrder {
+public:
+    static const bool stableSlots = true;   // items never move slots
+
+    template<typename OtherAllocator> using rebind = BasicTreeOrder<OtherAllocator>;
+
+    explicit BasicTreeOrder(const Allocator& allocator = Allocator()) : _nodes(allocator), _free(allocator), _root(-1), _seed(0x9E3779B9) {}
+
+    int numFree() const { return _free.size(); }
+    void clear();
+    void reserve(int numSlots)          { _nodes.reserve(numSlots); }
+    void shrink_to_fit()                { _nodes.shrink_to_fit(); _free.shrink_to_fit(); }
+
+    int slotFor(int index) const;
+    int indexForSlot(int slot) const;
+    int nextSlot(int slot, int numSlots) const; // amortized O(1) when walking the whole order
+    int prevSlot(int slot) const;
+
+    int insert(int index, int numSlots);    // slot for a new item at index, numSlots if the storage needs to grow
+    void erase(int slot, int numSlots);
+    void move(int first, int last, int dest);   // move the items at [first, last) so the first is at dest
+    bool isFree(int slot) const         { return _nodes[slot].count == 0; }
+    void truncate(int numSlots);
+
+private:
+    struct Node {
+        int left, right, parent;
+        int count;          // number of items in this subtree, 0 if the slot is free
+        uint32_t priority;  // random, parents have higher priority than their children
+    };
+
+    VectorFor<Node, Allocator> _nodes;  // node per slot
+    VectorFor<int, Allocator> _free;    // free slots, reused first by insert
+    int _root;
+    uint32_t _seed;
+
+    int count(int node) const { return node < 0 ? 0 : _nodes[node].count; }
+    void update(int node);  // recalculate count and set children's parent
+    int merge(int a, int b);
+    void split(int node, int index, int& a, int& b);  // first index items into a, the rest into b
+};
+
+typedef BasicTreeOrder<> TreeOrder;
+
+
+//--------------------------------------------------------------
+// Index is the key index policy and Order is the order policy (see above)
+// e.g. msa::OrderedMap<string, T, msa::HashIndex<string>, msa::TreeOrder>
+// everything (the vectors, the index and the order) allocates with Allocator, rebound as needed
+// (see msa::pmr::OrderedMap below to allocate from a std::pmr::memory_resource)
+template<typename keyType, typename T, typename Index = MapIndex<keyType>, typename Order = DenseOrder, typename Allocator = allocator<T> >
 class OrderedMap {
+    // types other than keyType which can be used to look up items, if the index is transparent (see above)
+    // (numbers and enums always mean an index, e.g. m[kSpeed] with an enum of item indices)
+    template<typename K> using LookupKey = typename enable_if<Index::transparent && !is_same<K, keyType>::value
+                                                              && !is_arithmetic<K>::value && !is_enum<K>::value>::type;
+
 public:
+    typedef keyType key_type;
+    typedef T mapped_type;
+    typedef Allocator allocator_type;
+
+    OrderedMap() : OrderedMap(Allocator()) {}
+    explicit OrderedMap(const Allocator& allocator);
+
+    // copies rebuild the key index, as index handles point into the index they came from
+    // tokens (see below) are copied and moved along with the items, so they work on copies too
+    OrderedMap(const OrderedMap& other);
+    OrderedMap(const OrderedMap& other, const Allocator& allocator);
+    OrderedMap(OrderedMap&& other);
+    OrderedMap& operator=(const OrderedMap& other);
+    OrderedMap& operator=(OrderedMap&& other);
+
+    allocator_type get_allocator() const { return allocator_type(_values.get_allocator()); }
+
+    // iterators walk the items in order directly over the storage, without any key lookups or validation
+    // *it is a pair of references (key, item), e.g. for(auto&& [key, item] : myContainer) ...
+    // keys() and values() are views over just the keys or the items, e.g. for(auto& item : myContainer.values()) ...
+    // NOTE: like std::vector, iterators are invalidated when items are added or erased
+    enum IteratorPart { kItems, kKeys, kValues };
+    template<bool isConst, int part> class Iterator;
+    template<typename It> class Range;
+
+    typedef Iterator<false, kItems> iterator;
+    typedef Iterator<true, kItems> const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    iterator begin()                        { return iterator(this, 0); }
+    const_iterator begin() const            { return const_iterator(this, 0); }
+    const_iterator cbegin() const           { return begin(); }
+    iterator end()                          { return iterator(this, size(), -1); }
+    const_iterator end() const              { return const_iterator(this, size(), -1); }
+    const_iterator cend() const             { return end(); }
+
+    reverse_iterator rbegin()               { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const   { return const_reverse_iterator(end()); }
+    const_reverse_iterator crbegin() const  { return rbegin(); }
+    reverse_iterator rend()                 { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const     { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crend() const    { return rend(); }
+
+    Range< Iterator<true, kKeys> > keys() const         { return Range< Iterator<true, kKeys> >(Iterator<true, kKeys>(this, 0), Iterator<true, kKeys>(this, size(), -1)); }
+    Range< Iterator<false, kValues> > values()          { return Range< Iterator<false, kValues> >(Iterator<false, kValues>(this, 0), Iterator<false, kValues>(this, size(), -1)); }
+    Range< Iterator<true, kValues> > values() const     { return Range< Iterator<true, kValues> >(Iterator<true, kValues>(this, 0), Iterator<true, kValues>(this, size(), -1)); }
+
+    // get an iterator to the item with key, end() if the key doesn't exist
+    iterator iteratorFor(const keyType& key)                { int slot = _index.find(key, _vector); return slot < 0 ? end() : iterator(this, indexForSlot(slot), slot); }
+    const_iterator iteratorFor(const keyType& key) const    { int slot = _index.find(key, _vector); return slot < 0 ? end() : const_iterator(this, indexForSlot(slot), slot); }
+
 
     // get size
     int size() const;
 
     // add new item
-    // item will be cloned, stored internally and added to an stl::map and stl::vector as a pointer
+    // item will be cloned (or moved) and stored internally in a vector (in order of insertion), the key is added to the key index
     // if T is shared_ptr, ownership is taken care of automatically by shared_ptr
     // returns a reference to the new object added
+    // NOTE: like std::vector, references to items are invalidated when items are added or erased
     T& push_back(const keyType& key, const T& t);
+    T& push_back(keyType&& key, T&& t);     // moves the key and item in instead of copying
+
+    // add new item, constructing it in place from args (a single key lookup, and the item isn't copied)
+    // throws an exception if the key already exists
+    template<typename... Args> T& emplace_back(const keyType& key, Args&&... args);
+    template<typename... Args> T& emplace_back(keyType&& key, Args&&... args);
+
+    // add new item only if the key doesn't exist yet, otherwise args are left untouched
+    // (the key is looked up before the item is constructed, so unlike emplace_back this is two lookups when it's added)
+    // returns the new or existing item, and whether it was added
+    template<typename... Args> pair<T*, bool> try_emplace(const keyType& key, Args&&... args);
+    template<typename... Args> pair<T*, bool> try_emplace(keyType&& key, Args&&... args);
+
+    // add new item at index (0...size), moving everything from index onwards up by one
+    // O(log n) with TreeOrder, O(n) with DenseOrder
+    T& insertAt(int index, const keyType& key, const T& t);
+    T& insertAt(int index, keyType&& key, T&& t);
+
+    // reorder items, without changing keys or copying items (e.g. for drag to reorder)
+    // moveRange moves the items at [first, last) so that the first of them ends up at dest (0...size - (last - first)),
+    // move(from, to) is the same for a single item, swap(i, j) swaps two items
+    // O(log n) with TreeOrder (only the order changes), with DenseOrder only the span between the range and dest
+    // is shifted, and only the items in it are renumbered in the key index. swap is O(1) with both
+    // throws an exception if any of the indices are out of range
+    void move(int from, int to);
+    void moveRange(int first, int last, int dest);
+    void swap(int i, int j);
 
     // return reference to the stored object
-    // throws an exception of the index or key doesn't exist
+    // throws an exception of the index or key doesn't exist (if MSA_ORDEREDMAP_CHECKS is on)
     T& at(int index);                       // get by index
     const T& at(int index) const;           // get by index
 
@@ -39,23 +628,68 @@ public:
     const T& at(const keyType& key) const;  // get by key
 
     // [] operator overloads for above
-    // these also throw an exception if the index or key doesn't exist
+    // these also throw an exception if the index or key doesn't exist (if MSA_ORDEREDMAP_CHECKS is on)
     T& operator[](int index);               // get by index
     const T& operator[](int index) const;
 
     T& operator[](const keyType& key);      // get by key
     const T& operator[](const keyType& key) const;
 
-    // get the key for item at index. returns blank if doesn't exist
-    keyType keyFor(int index) const;
+    // get the key for item at index (a reference to the stored key, so nothing is copied)
+    // throws an exception if the index doesn't exist (if MSA_ORDEREDMAP_CHECKS is on)
+    // NOTE: like references to items, this is invalidated when items are added or erased
+    const keyType& keyFor(int index) const;
 
-    // get the index for item with key. returns -ve if doesn't exist
+    // get the index for item with key. returns -ve if doesn't exist (or throws an exception if MSA_ORDEREDMAP_CHECKS is on)
     int indexFor(const keyType& key) const;
 
     // see if key exists
     bool exists(const keyType& key) const;
 
-    // change key
+    // find item by key, returns NULL if the key doesn't exist
+    // a single lookup and never throws, so cheaper than exists() followed by at()
+    // e.g. if(auto data = myContainer.find("blufo")) ...
+    T* find(const keyType& key);
+    const T* find(const keyType& key) const;
+
+    // lookups by anything the index can compare with keys directly, e.g. string_view or const char* with string keys
+    // these don't construct a keyType (so don't allocate), otherwise they're the same as the above
+    template<typename K, typename = LookupKey<K> > T& at(const K& key)                  { return _values[validateKey(key, "msa::OrderedMap::at(K)")]; }
+    template<typename K, typename = LookupKey<K> > const T& at(const K& key) const      { return _values[validateKey(key, "msa::OrderedMap::at(K)")]; }
+    template<typename K, typename = LookupKey<K> > T& operator[](const K& key)          { return at(key); }
+    template<typename K, typename = LookupKey<K> > const T& operator[](const K& key) const { return at(key); }
+    template<typename K, typename = LookupKey<K> > int indexFor(const K& key) const     { int slot = validateKey(key, "msa::OrderedMap::indexFor(K)"); return slot < 0 ? -1 : indexForSlot(slot); }
+    template<typename K, typename = LookupKey<K> > bool exists(const K& key) const      { return _index.find(key, _vector) >= 0; }
+    template<typename K, typename = LookupKey<K> > T* find(const K& key)                { int slot = _index.find(key, _vector); return slot < 0 ? NULL : &_values[slot]; }
+    template<typename K, typename = LookupKey<K> > const T* find(const K& key) const    { int slot = _index.find(key, _vector); return slot < 0 ? NULL : &_values[slot]; }
+
+    // tokens, for accessing the same items over and over without looking their keys up each time
+    // e.g. Token memo = myContainer.tokenFor("memo"); then every frame: myContainer.at(memo)
+    // a token refers to the item itself (not its index), so it stays valid while other items are added, erased
+    // or moved around, and when the item's key is changed. once the item is erased the token is stale:
+    // exists() is false, find() returns NULL and at() throws an exception (regardless of MSA_ORDEREDMAP_CHECKS),
+    // a stale token never refers to another item. tokens are only valid for the map they came from (or one move constructed
+    // from it), assigning to a map makes its tokens stale
+    // the first token costs an O(n) setup, after that items keep track of their tokens as they move
+    struct Token {
+        int id = -1;
+        uint32_t generation = 0;
+    };
+
+    Token tokenFor(const keyType& key);     // returns a stale token if the key doesn't exist
+    template<typename K, typename = LookupKey<K> > Token tokenFor(const K& key)    { int slot = _index.find(key, _vector); return slot < 0 ? Token() : tokenForSlot(slot); }
+
+    bool exists(const Token& token) const   { return slotFor(token) >= 0; }
+    T& at(const Token& token)               { return _values[validateToken(token, "msa::OrderedMap::at(Token)")]; }
+    const T& at(const Token& token) const   { return _values[validateToken(token, "msa::OrderedMap::at(Token)")]; }
+    T& operator[](const Token& token)       { return at(token); }
+    const T& operator[](const Token& token) const { return at(token); }
+    T* find(const Token& token)             { int slot = slotFor(token); return slot < 0 ? NULL : &_values[slot]; }
+    const T* find(const Token& token) const { int slot = slotFor(token); return slot < 0 ? NULL : &_values[slot]; }
+    int indexFor(const Token& token) const  { int slot = slotFor(token); return slot < 0 ? -1 : indexForSlot(slot); }
+
+    // change key, the item stays where it is (it isn't copied or moved)
+    // throws an exception if newKey already exists (for another item)
     void changeKey(int index, const keyType& newKey);
     void changeKey(const keyType& oldKey, const keyType& newKey);
 
@@ -63,200 +697,1715 @@ public:
     void erase(int index);
     void erase(const keyType& key);
 
+    // erase by key or index, without preserving order: the last item is moved into the erased slot
+    // O(1), useful when order doesn't matter much (e.g. pools of objects)
+    void eraseUnordered(int index);
+    void eraseUnordered(const keyType& key);
+
+    // erase by anything the index can compare with keys directly (see find above)
+    template<typename K, typename = LookupKey<K> > void erase(const K& key)             { erase(indexForSlot(validateKey(key, "msa::OrderedMap::erase(K)"))); }
+    template<typename K, typename = LookupKey<K> > void eraseUnordered(const K& key)    { eraseUnordered(indexForSlot(validateKey(key, "msa::OrderedMap::eraseUnordered(K)"))); }
+
+    // erased items can be left in place as tombstones (skipped by index access) and compacted in one go later,
+    // when they make up more than maxErasedFraction (0...1) of the storage. this makes erase amortized O(1)
+    // while preserving order, but access by index is O(log n) while there are tombstones
+    // 0 (default) compacts on every erase, i.e. every erase is O(n)
+    // only applies to DenseOrder, TreeOrder never needs compacting as it reuses erased slots
+    void setCompactionThreshold(float maxErasedFraction);
+    float getCompactionThreshold() const;
+
+    // remove all tombstones now (DenseOrder only)
+    void compact();
+
+    // reserve storage for n items (in the vectors, order and key index together),
+    // so adding up to n items doesn't reallocate or rehash
+    void reserve(int n);
+
+    // number of items which fit without reallocating anything (including any tombstones)
+    int capacity() const;
+
+    // release unused memory, e.g. after erasing lots of items (this compacts any tombstones first)
+    void shrink_to_fit();
+
     // clear
     void clear();
 
+    // full O(n) consistency check of all internal containers, throws an exception if anything is wrong
+    // (regardless of MSA_ORDEREDMAP_CHECKS)
+    void checkInvariants() const;
+
 
     // ADVANCED
-    // if you know the index and the key
+    // if you know the index
     // fast erase without any validity checks
-    void fastErase(int index, const keyType& key);
+    void fastErase(int index);
+    void fastEraseUnordered(int index);
+
+private:
+    typedef typename Index::template rebind<Allocator> IndexType;
+    typedef typename Order::template rebind<Allocator> OrderType;
+    typedef typename IndexType::handle IndexHandle;
+
+    IndexType _index;           // index of each key in the vectors
+    typename IndexType::KeyVector _vector;          // vector of keys (to store the order)
+    VectorFor<IndexHandle, Allocator> _handles;     // handle to each key's entry in the index, in the same order as the keys
+    VectorFor<T, Allocator> _values;    // the actual data is stored here, densely in the same order as the keys
+    OrderType _order;           // which slot in the above vectors holds the item at each index
+    float _compactionThreshold = 0;
+
+    // tokens: items are given an id when a token is made for them, and each id has a generation which changes when
+    // the item is erased, so tokens for it are stale (and stay stale when the id is reused for another item)
+    struct TokenSlot {
+        int slot;               // -ve while the id is free
+        uint32_t generation;
+    };
+    VectorFor<TokenSlot, Allocator> _tokenSlots;    // slot of each id, empty until the first token is made
+    VectorFor<int, Allocator> _slotTokens;          // id of the item in each slot (-ve if none), while there are ids
+    VectorFor<int, Allocator> _freeTokens;          // ids free to reuse
+
+    // errorMessage is only turned into a string if the exception is thrown, so validation doesn't allocate
+    void validateIndex(int index, const char* errorMessage) const;
+    template<typename K> int validateKey(const K& key, const char* errorMessage) const;  // returns the slot for the key
+
+    // convert between item indices and slots in the vectors (these are the same with DenseOrder if there are no tombstones)
+    int slotFor(int index) const            { return _order.slotFor(index); }
+    int indexForSlot(int slot) const        { return _order.indexForSlot(slot); }
+
+    bool hasTokens() const                  { return !_tokenSlots.empty(); }
+    int slotFor(const Token& token) const;  // -ve if the token is stale
+    int validateToken(const Token& token, const char* errorMessage) const;  // returns the slot for the token
+    Token tokenForSlot(int slot);           // giving the item an id if it doesn't have one yet
+    void releaseToken(int slot);            // the item in slot is being erased, so its tokens are now stale
+    void releaseTokens();                   // every item is being erased
+    void resetTokens();                     // every item has been replaced (e.g. by assignment), none of them have ids
+    void slotMoved(int oldSlot, int slot);  // the item in oldSlot is now in slot, update its index entry and id
+    void rotateSlots(int first, int middle, int last);  // swap the items in [first, middle) with those in [middle, last)
+    static int parkedSlot(int slot)         { return -2 - slot; }  // temporary slot in the index while renumbering
+    void eraseSlots(int slot);              // remove slot onwards from the vectors
+    void releaseSlot(int slot);             // release the key and item in a slot which no longer holds an item
+    void changeKeyInSlot(int slot, const keyType& newKey, const char* errorMessage);
+
+    // add a new item at index if the key doesn't exist yet, constructing it from args
+    // returns the new or existing item, and whether it was added
+    template<typename K, typename... Args> pair<T*, bool> emplaceItem(int index, K&& key, Args&&... args);
+    void discardNewItem(int slot, int numSlots);    // undo a new item in slot which didn't make it into the index
+
+
+    // add all keys to the (empty) index again, e.g. after copying
+    void rebuildIndex();
+
+    // if something is erased, the slots in the key index need to be updated
+    // (everything from erasedSlot onwards has moved down by one)
+    // this goes through the index handles, so there are no key lookups
+    void updateMapIndices(int erasedSlot);
+};
+
+
+#ifdef MSA_ORDEREDMAP_PMR
+namespace pmr {
+// OrderedMap allocating everything from a std::pmr::memory_resource, e.g. to free a whole per frame map at once:
+//   std::pmr::monotonic_buffer_resource frameMemory;
+//   msa::pmr::OrderedMap<std::pmr::string, T> myContainer(&frameMemory);
+// (std::pmr::string keys also allocate from the resource, std::string keys would still use the heap)
+template<typename keyType, typename T, typename Index = MapIndex<keyType>, typename Order = DenseOrder>
+using OrderedMap = msa::OrderedMap<keyType, T, Index, Order, std::pmr::polymorphic_allocator<T> >;
+
+// memory resource with an inline buffer, which allocations come from while they fit (anything else goes to upstream)
+// space in the buffer is reused once everything in it has been freed (or straight away for the last allocation)
+template<size_t bufferSize>
+class InlineResource : public std::pmr::memory_resource {
+public:
+    explicit InlineResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) : _upstream(upstream), _used(0), _numBlocks(0) {}
+
+    InlineResource(const InlineResource&) = delete;
+    InlineResource& operator=(const InlineResource&) = delete;
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    alignas(max_align_t) char _buffer[bufferSize];
+    std::pmr::memory_resource* _upstream;
+    size_t _used;           // bytes used from the start of the buffer
+    int _numBlocks;         // allocations in the buffer
+
+    bool inBuffer(const void* p) const { return uintptr_t(p) >= uintptr_t(_buffer) && uintptr_t(p) < uintptr_t(_buffer + bufferSize); }
+};
+}
+
+// the inline buffer of a SmallOrderedMap, a base class so it's constructed before the map
+// it fits the three vectors the map reserves up front (keys, items and index handles), each aligned for anything
+template<typename keyType, typename T, int N, typename Hash, typename KeyEqual>
+struct SmallOrderedMapStorage {
+    static constexpr size_t alignedSize(size_t size) { return (size + alignof(max_align_t) - 1) / alignof(max_align_t) * alignof(max_align_t); }
+    typedef typename SmallIndex<keyType, N, Hash, KeyEqual>::handle IndexHandle;
+
+    pmr::InlineResource<alignedSize(N * sizeof(keyType)) + alignedSize(N * sizeof(T)) + alignedSize(N * sizeof(IndexHandle))> _resource;
+};
+
+//--------------------------------------------------------------
+// SmallOrderedMap: an OrderedMap with a SmallIndex, and storage for the keys, items and index handles of up to N items
+// inline in the map, so small maps (e.g. lots of per object parameter sets) don't allocate anything at all
+// msa::SmallOrderedMap<string, float> params;     // up to 16 items without allocating
+// past N items the vectors and the index move to the heap, like any other OrderedMap
+// keys and items which allocate themselves still do (e.g. strings longer than the small string buffer)
+// copies and moves copy or move the items into the other map's own buffer, so they're O(n)
+template<typename keyType, typename T, int N = 16, typename Hash = typename KeyTraits<keyType>::Hash, typename KeyEqual = typename KeyTraits<keyType>::KeyEqual>
+class SmallOrderedMap : private SmallOrderedMapStorage<keyType, T, N, Hash, KeyEqual>,
+                        public pmr::OrderedMap<keyType, T, SmallIndex<keyType, N, Hash, KeyEqual> > {
+public:
+    typedef pmr::OrderedMap<keyType, T, SmallIndex<keyType, N, Hash, KeyEqual> > OrderedMapType;
+
+    SmallOrderedMap() : OrderedMapType(&this->_resource) { this->reserve(N); }
+    SmallOrderedMap(const SmallOrderedMap& other) : SmallOrderedMap() { OrderedMapType::operator=(other); }
+    SmallOrderedMap(SmallOrderedMap&& other) : SmallOrderedMap() { OrderedMapType::operator=(std::move(other)); }
+    SmallOrderedMap& operator=(const SmallOrderedMap& other) { OrderedMapType::operator=(other); return *this; }
+    SmallOrderedMap& operator=(SmallOrderedMap&& other) { OrderedMapType::operator=(std::move(other)); return *this; }
+};
+#endif
+
+//--------------------------------------------------------------
+// bidirectional iterator over the items (or just keys or values) in order
+// it keeps both the index (for comparisons) and the slot (for access), so stepping only asks the order for the next slot
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+template<bool isConst, int part>
+class OrderedMap<keyType, T, Index, Order, Allocator>::Iterator {
+public:
+    typedef typename conditional<isConst, const OrderedMap, OrderedMap>::type MapType;
+    typedef typename conditional<isConst, const T, T>::type ItemType;
+
+    typedef bidirectional_iterator_tag iterator_category;
+    typedef ptrdiff_t difference_type;
+    typedef typename conditional<part == kKeys, keyType, typename conditional<part == kValues, T, pair<keyType, T> >::type>::type value_type;
+    typedef typename conditional<part == kKeys, const keyType&,
+            typename conditional<part == kValues, ItemType&, pair<const keyType&, ItemType&> >::type>::type reference;
+
+    // (key, item) pairs are made on the fly, so -> needs something to hold one
+    struct ArrowProxy {
+        reference ref;
+        reference* operator->() { return &ref; }
+    };
+    typedef typename conditional<part == kItems, ArrowProxy, typename remove_reference<reference>::type*>::type pointer;
+
+    Iterator() : _map(NULL), _index(0), _slot(-1) {}
+    Iterator(const Iterator<false, part>& other) : _map(other._map), _index(other._index), _slot(other._slot) {}   // iterator -> const_iterator
+
+    int index() const { return _index; }    // index of the item
+
+    reference operator*() const {
+        if constexpr(part == kKeys) return _map->_vector[_slot];
+        else if constexpr(part == kValues) return _map->_values[_slot];
+        else return reference(_map->_vector[_slot], _map->_values[_slot]);
+    }
+
+    pointer operator->() const {
+        if constexpr(part == kItems) return ArrowProxy{ **this };
+        else return &**this;
+    }
+
+    Iterator& operator++() {
+        _index++;
+        _slot = _map->_order.nextSlot(_slot, _map->_vector.size());
+        return *this;
+    }
+
+    Iterator& operator--() {
+        _index--;
+        _slot = _slot < 0 ? _map->slotFor(_index) : _map->_order.prevSlot(_slot);    // stepping back from end()
+        return *this;
+    }
+
+    Iterator operator++(int) { Iterator it = *this; ++*this; return it; }
+    Iterator operator--(int) { Iterator it = *this; --*this; return it; }
+
+    bool operator==(const Iterator& other) const { return _index == other._index; }
+    bool operator!=(const Iterator& other) const { return _index != other._index; }
 
 private:
-    map<keyType, pair<T, int> > _map;       // the actual data is stored here, along with index in vector
-    vector< keyType > _vector;  // vector of keys (to store the order)
+    friend class OrderedMap;
+    template<bool, int> friend class Iterator;
+
+    MapType* _map;
+    int _index;
+    int _slot;  // -ve at end()
+
+    Iterator(MapType* map, int index) : _map(map), _index(index), _slot(index < map->size() ? map->slotFor(index) : -1) {}
+    Iterator(MapType* map, int index, int slot) : _map(map), _index(index), _slot(slot) {}
+};
 
-    void validateIndex(int index, string errorMessage) const;
-    void validateKey(const keyType& key, string errorMessage) const;
+//--------------------------------------------------------------
+// a pair of iterators, for range based for loops
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+template<typename It>
+class OrderedMap<keyType, T, Index, Order, Allocator>::Range {
+public:
+    Range(It begin, It end) : _begin(begin), _end(end) {}
 
+    It begin() const { return _begin; }
+    It end() const { return _end; }
 
-    // if something is erased, the indices in the map need to be updated
-    void updateMapIndices();
+private:
+    It _begin, _end;
 };
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-void OrderedMap<keyType, T>::clear() {
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::clear() {
     _vector.clear();
-    _map.clear();
+    _handles.clear();
+    _values.clear();
+    _index.clear();
+    _order.clear();
+    releaseTokens();
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-int OrderedMap<keyType, T>::size() const {
-    // if these aren't equal, something went wrong somewhere. not good!
-    if(_map.size() != _vector.size()) throw runtime_error("msa::OrderedMap::size() - map size doesn't equal vector size");
-    return _vector.size();
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+OrderedMap<keyType, T, Index, Order, Allocator>::OrderedMap(const Allocator& allocator)
+    : _index(allocator), _vector(allocator), _handles(allocator), _values(allocator), _order(allocator),
+      _tokenSlots(allocator), _slotTokens(allocator), _freeTokens(allocator) {
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-T& OrderedMap<keyType, T>::push_back(const keyType& key, const T& t) {
-    if(exists(key)) {
-        throw invalid_argument("msa::OrderedMap::push_back(keyType, T&) - key already exists");
-        return at(key);
-    } else {
-        _map[key] = make_pair(t, _vector.size());
-        _vector.push_back(key);
-        size();	// to validate if correctly added to both containers, should be ok
-        return at(key);
-    }
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+OrderedMap<keyType, T, Index, Order, Allocator>::OrderedMap(const OrderedMap& other)
+    : OrderedMap(other, allocator_traits<Allocator>::select_on_container_copy_construction(other.get_allocator())) {
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-T& OrderedMap<keyType, T>::at(int index) {
-    validateIndex(index, "msa::OrderedMap::at(int)");
-    return at(_vector[index]);
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+OrderedMap<keyType, T, Index, Order, Allocator>::OrderedMap(const OrderedMap& other, const Allocator& allocator)
+    : OrderedMap(allocator) {
+    *this = other;
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-const T& OrderedMap<keyType, T>::at(int index) const {
-    validateIndex(index, "msa::OrderedMap::at(int)");
-    return at(_vector[index]);
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+OrderedMap<keyType, T, Index, Order, Allocator>::OrderedMap(OrderedMap&& other)
+    : _index(std::move(other._index)), _vector(std::move(other._vector)), _handles(std::move(other._handles)),
+      _values(std::move(other._values)), _order(std::move(other._order)), _compactionThreshold(other._compactionThreshold),
+      _tokenSlots(other._tokenSlots, other._tokenSlots.get_allocator()), _slotTokens(std::move(other._slotTokens)),
+      _freeTokens(other._freeTokens, other._freeTokens.get_allocator()) {
+    // the index nodes have moved over too, so the handles are still valid
+    // tokens stay valid here, while the other map keeps the ids as stale, so the ids it gives out next never alias them
+    // (so the token ids are copied, with the other map's allocator like everything else, rather than moved)
+    other.clear();
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-T& OrderedMap<keyType, T>::at(const keyType& key) {
-    validateKey(key, "msa::OrderedMap::at(keyType)");
-    return _map.at(key).first;
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+OrderedMap<keyType, T, Index, Order, Allocator>& OrderedMap<keyType, T, Index, Order, Allocator>::operator=(const OrderedMap& other) {
+    if(this == &other) return *this;
+    _vector = other._vector;
+    _handles = other._handles;
+    _values = other._values;
+    _order = other._order;
+    _compactionThreshold = other._compactionThreshold;
+    resetTokens();
+    rebuildIndex();
+    return *this;
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-const T& OrderedMap<keyType, T>::at(const keyType& key) const {
-    validateKey(key, "msa::OrderedMap::at(keyType)");
-    return _map.at(key).first;
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+OrderedMap<keyType, T, Index, Order, Allocator>& OrderedMap<keyType, T, Index, Order, Allocator>::operator=(OrderedMap&& other) {
+    if(this == &other) return *this;
+    // with different allocators the index nodes are moved one by one into new nodes, so the handles need rebuilding
+    bool sameNodes = allocator_traits<Allocator>::propagate_on_container_move_assignment::value || get_allocator() == other.get_allocator();
+    _vector = std::move(other._vector);
+    _handles = std::move(other._handles);
+    _values = std::move(other._values);
+    _order = std::move(other._order);
+    _compactionThreshold = other._compactionThreshold;
+    resetTokens();
+    if(sameNodes) _index = std::move(other._index);
+    else rebuildIndex();
+    other.clear();
+    return *this;
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-T& OrderedMap<keyType, T>::operator[](int index) {
-    return at(index);
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::rebuildIndex() {
+    _index.clear();
+    for(int slot=0; slot<int(_vector.size()); slot++) {
+        if(!_order.isFree(slot)) _index.insert(_vector[slot], slot, _vector, _handles[slot]);
+    }
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-const T& OrderedMap<keyType, T>::operator[](int index) const {
-    return at(index);
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::reserve(int n) {
+    _vector.reserve(n);
+    _handles.reserve(n);
+    _values.reserve(n);
+    _order.reserve(n);
+    _index.reserve(n, _vector);
+    if(hasTokens()) _slotTokens.reserve(n);
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-T& OrderedMap<keyType, T>::operator[](const keyType& key) {
-    return at(key);
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+int OrderedMap<keyType, T, Index, Order, Allocator>::capacity() const {
+    return min(int(min(_vector.capacity(), min(_handles.capacity(), _values.capacity()))), _index.capacity());
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-const T& OrderedMap<keyType, T>::operator[](const keyType& key) const {
-    return at(key);
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::shrink_to_fit() {
+    compact();
+    _vector.shrink_to_fit();
+    _handles.shrink_to_fit();
+    _slotTokens.shrink_to_fit();
+    _values.shrink_to_fit();
+    _order.shrink_to_fit();
+    _index.shrink_to_fit(_vector);
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-keyType OrderedMap<keyType, T>::keyFor(int index) const {
-    validateIndex(index, "msa::OrderedMap::keyFor(int)");
-    return _vector[index];
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+int OrderedMap<keyType, T, Index, Order, Allocator>::size() const {
+    int size = _vector.size() - _order.numFree();
+#if MSA_ORDEREDMAP_CHECKS
+    // if these aren't equal, something went wrong somewhere. not good!
+    if(_handles.size() != _vector.size() || _values.size() != _vector.size()) throw runtime_error("msa::OrderedMap::size() - vector sizes don't match");
+    if(hasTokens() && _slotTokens.size() != _vector.size()) throw runtime_error("msa::OrderedMap::size() - token vector size doesn't match");
+    if(_index.size() != size) throw runtime_error("msa::OrderedMap::size() - index size doesn't equal vector size");
+#endif
+    return size;
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-int OrderedMap<keyType, T>::indexFor(const keyType& key) const {
-    validateKey(key, "msa::OrderedMap::indexFor(keyType)");
-    return _map.at(key).second;
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+T& OrderedMap<keyType, T, Index, Order, Allocator>::push_back(const keyType& key, const T& t) {
+    auto result = emplaceItem(size(), key, t);
+    if(!result.second) throw invalid_argument("msa::OrderedMap::push_back(keyType, T&) - key already exists");
+    size();	// to validate if correctly added to all containers, should be ok
+    return *result.first;
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-void OrderedMap<keyType, T>::changeKey(int index, const keyType& newKey) {
-    validateIndex(index, "msa::OrderedMap::changeKey(int)");
-    changeKey(keyFor(index), newKey);
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+T& OrderedMap<keyType, T, Index, Order, Allocator>::push_back(keyType&& key, T&& t) {
+    auto result = emplaceItem(size(), std::move(key), std::move(t));
+    if(!result.second) throw invalid_argument("msa::OrderedMap::push_back(keyType&&, T&&) - key already exists");
+    size();	// to validate if correctly added to all containers, should be ok
+    return *result.first;
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-void OrderedMap<keyType, T>::changeKey(const keyType& oldKey, const keyType& newKey) {
-    validateKey(oldKey, "msa::OrderedMap::changeKey(keyType)");
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+template<typename... Args>
+T& OrderedMap<keyType, T, Index, Order, Allocator>::emplace_back(const keyType& key, Args&&... args) {
+    auto result = emplaceItem(size(), key, std::forward<Args>(args)...);
+    if(!result.second) throw invalid_argument("msa::OrderedMap::emplace_back(keyType, Args...) - key already exists");
+    size();	// to validate if correctly added to all containers, should be ok
+    return *result.first;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+template<typename... Args>
+T& OrderedMap<keyType, T, Index, Order, Allocator>::emplace_back(keyType&& key, Args&&... args) {
+    auto result = emplaceItem(size(), std::move(key), std::forward<Args>(args)...);
+    if(!result.second) throw invalid_argument("msa::OrderedMap::emplace_back(keyType&&, Args...) - key already exists");
+    size();	// to validate if correctly added to all containers, should be ok
+    return *result.first;
+}
 
-    // save temp copy
-    auto t = _map[oldKey];
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+template<typename... Args>
+pair<T*, bool> OrderedMap<keyType, T, Index, Order, Allocator>::try_emplace(const keyType& key, Args&&... args) {
+    int slot = _index.find(key, _vector);
+    if(slot >= 0) return make_pair(&_values[slot], false);
+    return emplaceItem(size(), key, std::forward<Args>(args)...);
+}
 
-    // erase from map, and reinsert
-    _map.erase(oldKey);
-    _map[newKey] = t;
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+template<typename... Args>
+pair<T*, bool> OrderedMap<keyType, T, Index, Order, Allocator>::try_emplace(keyType&& key, Args&&... args) {
+    int slot = _index.find(key, _vector);
+    if(slot >= 0) return make_pair(&_values[slot], false);
+    return emplaceItem(size(), std::move(key), std::forward<Args>(args)...);
+}
 
-    // change key from the vector
-    _vector.at(t.second) = newKey;
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+T& OrderedMap<keyType, T, Index, Order, Allocator>::insertAt(int index, const keyType& key, const T& t) {
+    if(index<0 || index > size()) throw invalid_argument("msa::OrderedMap::insertAt(int, keyType, T&) - index out of range");
+    auto result = emplaceItem(index, key, t);
+    if(!result.second) throw invalid_argument("msa::OrderedMap::insertAt(int, keyType, T&) - key already exists");
+    size();	// to validate if correctly added to all containers, should be ok
+    return *result.first;
 }
 
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+T& OrderedMap<keyType, T, Index, Order, Allocator>::insertAt(int index, keyType&& key, T&& t) {
+    if(index<0 || index > size()) throw invalid_argument("msa::OrderedMap::insertAt(int, keyType&&, T&&) - index out of range");
+    auto result = emplaceItem(index, std::move(key), std::move(t));
+    if(!result.second) throw invalid_argument("msa::OrderedMap::insertAt(int, keyType&&, T&&) - key already exists");
+    size();	// to validate if correctly added to all containers, should be ok
+    return *result.first;
+}
 
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::move(int from, int to) {
+    if(from<0 || from >= size()) throw invalid_argument("msa::OrderedMap::move(int, int) - index out of range");
+    if(to<0 || to >= size()) throw invalid_argument("msa::OrderedMap::move(int, int) - destination out of range");
+    moveRange(from, from + 1, to);
+}
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-void OrderedMap<keyType, T>::erase(int index) {
-    validateIndex(index, "msa::OrderedMap::erase(int)");
-    fastErase(index, keyFor(index));
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::moveRange(int first, int last, int dest) {
+    if(first<0 || last > size() || first > last) throw invalid_argument("msa::OrderedMap::moveRange(int, int, int) - range out of range");
+    if(dest<0 || dest > size() - (last - first)) throw invalid_argument("msa::OrderedMap::moveRange(int, int, int) - destination out of range");
+    if(first == last || first == dest) return;
+
+    if constexpr(Order::stableSlots) {
+        _order.move(first, last, dest);
+    } else {
+        compact();
+        // the range and the items between it and dest swap places
+        int count = last - first;
+        if(dest < first) rotateSlots(dest, first, last);
+        else rotateSlots(first, last, dest + count);
+    }
     size(); // validate map and vector have same sizes to make sure everything worked alright
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-void OrderedMap<keyType, T>::erase(const keyType& key) {
-    validateKey(key, "msa::OrderedMap::erase(keyType)");
-    fastErase(indexFor(key), key);
-    size(); // validate map and vector have same sizes to make sure everything worked alright
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::swap(int i, int j) {
+    validateIndex(i, "msa::OrderedMap::swap(int, int)");
+    validateIndex(j, "msa::OrderedMap::swap(int, int)");
+    if(i == j) return;
+
+    // swap what's in the two slots, the order stays the same
+    int slotI = slotFor(i);
+    int slotJ = slotFor(j);
+    std::swap(_vector[slotI], _vector[slotJ]);
+    std::swap(_handles[slotI], _handles[slotJ]);
+    std::swap(_values[slotI], _values[slotJ]);
+    if(hasTokens()) std::swap(_slotTokens[slotI], _slotTokens[slotJ]);
+
+    // one item is parked while the other takes its slot, so slots in the index stay unique
+    _index.setIndex(_handles[slotI], slotJ, parkedSlot(slotJ));
+    slotMoved(slotI, slotJ);
+    slotMoved(parkedSlot(slotJ), slotI);
 }
 
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+template<typename K, typename... Args>
+pair<T*, bool> OrderedMap<keyType, T, Index, Order, Allocator>::emplaceItem(int index, K&& key, Args&&... args) {
+    // with DenseOrder, items can only go in between others once the tombstones are gone
+    if(!Order::stableSlots && index < size()) compact();
+
+    // the item goes into a new slot at the end (or the free slot it reuses) before its key goes into the index,
+    // which is also the check for an existing key. so if the key exists, or constructing anything throws,
+    // only that slot needs undoing, and the index never has an entry for an item which isn't there
+    int numSlots = _vector.size();
+    int slot = _order.insert(index, numSlots);
+    int newSlot = Order::stableSlots ? slot : numSlots;
+    IndexHandle h{};
+    int existingSlot;
+    try {
+        if(newSlot == numSlots) {
+            _vector.push_back(std::forward<K>(key));
+            _handles.push_back(h);
+            _values.emplace_back(std::forward<Args>(args)...);
+            if(hasTokens()) _slotTokens.push_back(-1);
+        } else {
+            _vector[newSlot] = std::forward<K>(key);
+            _values[newSlot] = T(std::forward<Args>(args)...);
+        }
+        existingSlot = _index.insert(_vector[newSlot], newSlot, _vector, h);
+    } catch(...) {
+        discardNewItem(newSlot, numSlots);
+        throw;
+    }
+    if(existingSlot >= 0) {
+        discardNewItem(newSlot, numSlots);
+        return make_pair(&_values[existingSlot], false);
+    }
+    _handles[newSlot] = h;
+
+    // with DenseOrder, rotate it into place, moving everything from slot onwards up by one
+    if(newSlot != slot) rotateSlots(slot, numSlots, numSlots + 1);
+    return make_pair(&_values[slot], true);
+}
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-void OrderedMap<keyType, T>::fastErase(int index, const keyType& key) {
-    _map.erase(key);
-    _vector.erase(_vector.begin() + index);
-    updateMapIndices();
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::discardNewItem(int slot, int numSlots) {
+    if(Order::stableSlots) _order.erase(slot, numSlots);
+    if(slot < numSlots) releaseSlot(slot);
+    else eraseSlots(numSlots);
 }
 
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+T& OrderedMap<keyType, T, Index, Order, Allocator>::at(int index) {
+    validateIndex(index, "msa::OrderedMap::at(int)");
+    return _values[slotFor(index)];
+}
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-bool OrderedMap<keyType, T>::exists(const keyType& key) const {
-    return _map.find(key) != _map.end();
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+const T& OrderedMap<keyType, T, Index, Order, Allocator>::at(int index) const {
+    validateIndex(index, "msa::OrderedMap::at(int)");
+    return _values[slotFor(index)];
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-void OrderedMap<keyType, T>::validateIndex(int index, string errorMessage) const {
-    if(index<0 || index >= _vector.size()) throw invalid_argument(errorMessage + " - index doesn't exist");
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+T& OrderedMap<keyType, T, Index, Order, Allocator>::at(const keyType& key) {
+    return _values[validateKey(key, "msa::OrderedMap::at(keyType)")];
 }
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-void OrderedMap<keyType, T>::validateKey(const keyType& key, string errorMessage) const {
-    if(!exists(key)) throw invalid_argument(errorMessage + " - key doesn't exist");
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+const T& OrderedMap<keyType, T, Index, Order, Allocator>::at(const keyType& key) const {
+    return _values[validateKey(key, "msa::OrderedMap::at(keyType)")];
 }
 
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+T& OrderedMap<keyType, T, Index, Order, Allocator>::operator[](int index) {
+    return at(index);
+}
 
 //--------------------------------------------------------------
-template<typename keyType, typename T>
-void OrderedMap<keyType, T>::updateMapIndices() {
-    for(int i=0; i<_vector.size(); i++) {
-        const keyType& key = _vector[i];
-        _map[key].second = i;
-    }
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+const T& OrderedMap<keyType, T, Index, Order, Allocator>::operator[](int index) const {
+    return at(index);
 }
 
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+T& OrderedMap<keyType, T, Index, Order, Allocator>::operator[](const keyType& key) {
+    return at(key);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+const T& OrderedMap<keyType, T, Index, Order, Allocator>::operator[](const keyType& key) const {
+    return at(key);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+const keyType& OrderedMap<keyType, T, Index, Order, Allocator>::keyFor(int index) const {
+    validateIndex(index, "msa::OrderedMap::keyFor(int)");
+    return _vector[slotFor(index)];
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+int OrderedMap<keyType, T, Index, Order, Allocator>::indexFor(const keyType& key) const {
+    int slot = validateKey(key, "msa::OrderedMap::indexFor(keyType)");
+    return slot < 0 ? -1 : indexForSlot(slot);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::changeKey(int index, const keyType& newKey) {
+    validateIndex(index, "msa::OrderedMap::changeKey(int)");
+    changeKeyInSlot(slotFor(index), newKey, "msa::OrderedMap::changeKey(int)");
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::changeKey(const keyType& oldKey, const keyType& newKey) {
+    changeKeyInSlot(validateKey(oldKey, "msa::OrderedMap::changeKey(keyType)"), newKey, "msa::OrderedMap::changeKey(keyType)");
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::changeKeyInSlot(int slot, const keyType& newKey, const char* errorMessage) {
+    // only the index entry is rekeyed, the data stays where it is (it isn't copied or moved)
+    int existingSlot = _index.rename(_handles[slot], slot, newKey, _vector);
+    if(existingSlot == slot) return;    // same key
+    if(existingSlot >= 0) throw invalid_argument(string(errorMessage) + " - new key already exists");
+
+    // change key in the vector
+    _vector[slot] = newKey;
+}
+
+
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::erase(int index) {
+    validateIndex(index, "msa::OrderedMap::erase(int)");
+    fastErase(index);
+    size(); // validate map and vector have same sizes to make sure everything worked alright
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::erase(const keyType& key) {
+    fastErase(indexForSlot(validateKey(key, "msa::OrderedMap::erase(keyType)")));
+    size(); // validate map and vector have same sizes to make sure everything worked alright
+}
+
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::fastErase(int index) {
+    int slot = slotFor(index);
+    _index.erase(_handles[slot], slot, _vector);
+    releaseToken(slot);
+
+    if(Order::stableSlots || _compactionThreshold > 0) {
+        // free the slot (releasing the data), with DenseOrder this leaves a tombstone, and only compacts when there are too many
+        _order.erase(slot, _vector.size());
+        releaseSlot(slot);
+        if(!Order::stableSlots && _order.numFree() > _compactionThreshold * _vector.size()) compact();
+    } else {
+        _vector.erase(_vector.begin() + slot);
+        _handles.erase(_handles.begin() + slot);
+        _values.erase(_values.begin() + slot);
+        if(hasTokens()) _slotTokens.erase(_slotTokens.begin() + slot);
+        updateMapIndices(slot);
+    }
+}
+
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::eraseUnordered(int index) {
+    validateIndex(index, "msa::OrderedMap::eraseUnordered(int)");
+    fastEraseUnordered(index);
+    size(); // validate map and vector have same sizes to make sure everything worked alright
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::eraseUnordered(const keyType& key) {
+    fastEraseUnordered(indexForSlot(validateKey(key, "msa::OrderedMap::eraseUnordered(keyType)")));
+    size(); // validate map and vector have same sizes to make sure everything worked alright
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::fastEraseUnordered(int index) {
+    int slot = slotFor(index);
+    int lastSlot = slotFor(size() - 1);
+    _index.erase(_handles[slot], slot, _vector);
+    releaseToken(slot);
+
+    // move the last item into the erased slot, only its slot needs updating
+    if(slot != lastSlot) {
+        _vector[slot] = std::move(_vector[lastSlot]);
+        _handles[slot] = _handles[lastSlot];
+        _values[slot] = std::move(_values[lastSlot]);
+        if(hasTokens()) _slotTokens[slot] = _slotTokens[lastSlot];
+        slotMoved(lastSlot, slot);
+    }
+
+    if(Order::stableSlots) {
+        // slot keeps its place in the order, so now the last slot is free
+        _order.erase(lastSlot, _vector.size());
+        releaseSlot(lastSlot);
+    } else {
+        // anything after the last item is a tombstone, so can go too
+        eraseSlots(lastSlot);
+    }
+}
+
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::setCompactionThreshold(float maxErasedFraction) {
+    _compactionThreshold = maxErasedFraction;
+    if(_compactionThreshold <= 0) compact();
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+float OrderedMap<keyType, T, Index, Order, Allocator>::getCompactionThreshold() const {
+    return _compactionThreshold;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::compact() {
+    if(Order::stableSlots || _order.numFree() == 0) return;
+
+    // move all live items down over the tombstones, keeping their order
+    int numSlots = _vector.size();
+    int index = 0;
+    for(int slot=0; slot<numSlots; slot++) {
+        if(_order.isFree(slot)) continue;
+        if(index != slot) {
+            _vector[index] = std::move(_vector[slot]);
+            _handles[index] = _handles[slot];
+            _values[index] = std::move(_values[slot]);
+            if(hasTokens()) _slotTokens[index] = _slotTokens[slot];
+            slotMoved(slot, index);
+        }
+        index++;
+    }
+    eraseSlots(index);
+    _order.clear();
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::releaseSlot(int slot) {
+    // the item is moved out and destroyed (so T doesn't need a default constructor), leaving a moved-from T in the slot
+    _vector[slot] = keyType();
+    T released(std::move(_values[slot]));
+    (void)released;
+    if(hasTokens()) _slotTokens[slot] = -1;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::eraseSlots(int slot) {
+    _vector.erase(_vector.begin() + slot, _vector.end());
+    _handles.erase(_handles.begin() + slot, _handles.end());
+    _values.erase(_values.begin() + slot, _values.end());
+    if(hasTokens()) _slotTokens.erase(_slotTokens.begin() + slot, _slotTokens.end());
+    _order.truncate(slot);
+}
+
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+bool OrderedMap<keyType, T, Index, Order, Allocator>::exists(const keyType& key) const {
+    return _index.find(key, _vector) >= 0;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+T* OrderedMap<keyType, T, Index, Order, Allocator>::find(const keyType& key) {
+    int slot = _index.find(key, _vector);
+    return slot < 0 ? NULL : &_values[slot];
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+const T* OrderedMap<keyType, T, Index, Order, Allocator>::find(const keyType& key) const {
+    int slot = _index.find(key, _vector);
+    return slot < 0 ? NULL : &_values[slot];
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::validateIndex(int index, const char* errorMessage) const {
+#if MSA_ORDEREDMAP_CHECKS
+    if(index<0 || index >= int(_vector.size()) - _order.numFree()) throw invalid_argument(string(errorMessage) + " - index doesn't exist");
+#else
+    (void)index;
+    (void)errorMessage;
+#endif
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+template<typename K>
+int OrderedMap<keyType, T, Index, Order, Allocator>::validateKey(const K& key, const char* errorMessage) const {
+    int slot = _index.find(key, _vector);
+#if MSA_ORDEREDMAP_CHECKS
+    if(slot < 0) throw invalid_argument(string(errorMessage) + " - key doesn't exist");
+#else
+    (void)errorMessage;
+#endif
+    return slot;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+typename OrderedMap<keyType, T, Index, Order, Allocator>::Token OrderedMap<keyType, T, Index, Order, Allocator>::tokenFor(const keyType& key) {
+    int slot = _index.find(key, _vector);
+    return slot < 0 ? Token() : tokenForSlot(slot);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+int OrderedMap<keyType, T, Index, Order, Allocator>::slotFor(const Token& token) const {
+    if(token.id < 0 || token.id >= int(_tokenSlots.size())) return -1;
+    const TokenSlot& tokenSlot = _tokenSlots[token.id];
+    return tokenSlot.generation == token.generation ? tokenSlot.slot : -1;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+int OrderedMap<keyType, T, Index, Order, Allocator>::validateToken(const Token& token, const char* errorMessage) const {
+    int slot = slotFor(token);
+    if(slot < 0) throw invalid_argument(string(errorMessage) + " - token is stale");
+    return slot;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+typename OrderedMap<keyType, T, Index, Order, Allocator>::Token OrderedMap<keyType, T, Index, Order, Allocator>::tokenForSlot(int slot) {
+    // the first token, from now on every slot has an id (or -1)
+    if(!hasTokens()) _slotTokens.assign(_vector.size(), -1);
+
+    int id = _slotTokens[slot];
+    if(id < 0) {
+        if(_freeTokens.empty()) {
+            id = _tokenSlots.size();
+            _tokenSlots.push_back(TokenSlot{ slot, 0 });
+        } else {
+            id = _freeTokens.back();
+            _freeTokens.pop_back();
+            _tokenSlots[id].slot = slot;
+        }
+        _slotTokens[slot] = id;
+    }
+    return Token{ id, _tokenSlots[id].generation };
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::releaseToken(int slot) {
+    if(!hasTokens() || _slotTokens[slot] < 0) return;
+    int id = _slotTokens[slot];
+    _tokenSlots[id].slot = -1;
+    _tokenSlots[id].generation++;
+    _freeTokens.push_back(id);
+    _slotTokens[slot] = -1;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::releaseTokens() {
+    // make every token stale, without forgetting the generations (so none of them become valid again)
+    for(int id=0; id<int(_tokenSlots.size()); id++) {
+        if(_tokenSlots[id].slot < 0) continue;
+        _tokenSlots[id].slot = -1;
+        _tokenSlots[id].generation++;
+        _freeTokens.push_back(id);
+    }
+    _slotTokens.clear();
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::resetTokens() {
+    // the ids (and generations) stay this map's own, rather than being taken from the map assigned from,
+    // so tokens for the old items are stale instead of aliasing the new ones
+    releaseTokens();
+    if(hasTokens()) _slotTokens.assign(_vector.size(), -1);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::slotMoved(int oldSlot, int slot) {
+    _index.setIndex(_handles[slot], oldSlot, slot);
+    if(hasTokens() && _slotTokens[slot] >= 0) _tokenSlots[_slotTokens[slot]].slot = slot;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::checkInvariants() const {
+    int numSlots = _vector.size();
+    if(int(_handles.size()) != numSlots || int(_values.size()) != numSlots) throw runtime_error("msa::OrderedMap::checkInvariants() - vector sizes don't match");
+
+    int numFree = 0;
+    for(int slot=0; slot<numSlots; slot++) numFree += _order.isFree(slot);
+    if(numFree != _order.numFree()) throw runtime_error("msa::OrderedMap::checkInvariants() - free slot count is wrong");
+
+    int size = numSlots - numFree;
+    if(_index.size() != size) throw runtime_error("msa::OrderedMap::checkInvariants() - index size doesn't equal number of items");
+
+    // every item must be in a live slot which maps back to its index, and its key must be indexed to that slot
+    for(int i=0; i<size; i++) {
+        int slot = slotFor(i);
+        if(slot<0 || slot >= numSlots || _order.isFree(slot)) throw runtime_error("msa::OrderedMap::checkInvariants() - index " + ofToString(i) + " doesn't map to an item");
+        if(indexForSlot(slot) != i) throw runtime_error("msa::OrderedMap::checkInvariants() - slot for index " + ofToString(i) + " maps back to the wrong index");
+        if(_index.find(_vector[slot], _vector) != slot) throw runtime_error("msa::OrderedMap::checkInvariants() - key for index " + ofToString(i) + " isn't indexed correctly");
+    }
+
+    // every id in use must belong to the item in its slot
+    if(!hasTokens()) return;
+    if(int(_slotTokens.size()) != numSlots) throw runtime_error("msa::OrderedMap::checkInvariants() - token vector size doesn't match");
+    int numIds = 0;
+    for(int slot=0; slot<numSlots; slot++) {
+        int id = _slotTokens[slot];
+        if(id < 0) continue;
+        if(_order.isFree(slot) || id >= int(_tokenSlots.size()) || _tokenSlots[id].slot != slot) throw runtime_error("msa::OrderedMap::checkInvariants() - token for slot " + ofToString(slot) + " is wrong");
+        numIds++;
+    }
+    if(numIds + _freeTokens.size() != _tokenSlots.size()) throw runtime_error("msa::OrderedMap::checkInvariants() - token ids are lost");
+}
+
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::rotateSlots(int first, int middle, int last) {
+    std::rotate(_vector.begin() + first, _vector.begin() + middle, _vector.begin() + last);
+    std::rotate(_handles.begin() + first, _handles.begin() + middle, _handles.begin() + last);
+    std::rotate(_values.begin() + first, _values.begin() + middle, _values.begin() + last);
+    if(hasTokens()) std::rotate(_slotTokens.begin() + first, _slotTokens.begin() + middle, _slotTokens.begin() + last);
+
+    // renumber the moved items in the index. the smaller block is parked on temporary slots first,
+    // then the other block shifts over (in an order which never lands on a slot still in use), so slots stay unique
+    int numLeft = middle - first;   // these are now at first + numRight onwards
+    int numRight = last - middle;   // these are now at first onwards
+    if(numLeft <= numRight) {
+        for(int i=0; i<numLeft; i++) _index.setIndex(_handles[first + numRight + i], first + i, parkedSlot(first + i));
+        for(int i=0; i<numRight; i++) slotMoved(middle + i, first + i);
+        for(int i=0; i<numLeft; i++) slotMoved(parkedSlot(first + i), first + numRight + i);
+    } else {
+        for(int i=0; i<numRight; i++) _index.setIndex(_handles[first + i], middle + i, parkedSlot(middle + i));
+        for(int i=numLeft-1; i>=0; i--) slotMoved(first + i, first + numRight + i);
+        for(int i=0; i<numRight; i++) slotMoved(parkedSlot(middle + i), first + i);
+    }
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Order, typename Allocator>
+void OrderedMap<keyType, T, Index, Order, Allocator>::updateMapIndices(int erasedSlot) {
+    for(int i=erasedSlot; i<int(_handles.size()); i++) {
+        slotMoved(i + 1, i);
+    }
+}
+
+
+
+//--------------------------------------------------------------
+// StdMapIndex implementation
+//--------------------------------------------------------------
+template<typename mapType, bool transparentLookup, bool convertKeys>
+StdMapIndex<mapType, transparentLookup, convertKeys>::StdMapIndex(StdMapIndex&& other) : _keys(other._keys), _set(std::move(other._set)) {
+    // the moved set's comparisons point at the keys which came with it, so the other index needs new ones
+    other._keys = NULL;
+    other._keys = newKeys(other._set.get_allocator());
+    other._set = newSet(other._keys, other._set.get_allocator());
+}
+
+//--------------------------------------------------------------
+template<typename mapType, bool transparentLookup, bool convertKeys>
+StdMapIndex<mapType, transparentLookup, convertKeys>& StdMapIndex<mapType, transparentLookup, convertKeys>::operator=(StdMapIndex&& other) {
+    if(this == &other) return *this;
+    deleteKeys();
+    _keys = other._keys;
+    _set = std::move(other._set);
+    other._keys = NULL;
+    other._keys = newKeys(other._set.get_allocator());
+    other._set = newSet(other._keys, other._set.get_allocator());
+    return *this;
+}
+
+//--------------------------------------------------------------
+template<typename mapType, bool transparentLookup, bool convertKeys>
+typename StdMapIndex<mapType, transparentLookup, convertKeys>::Keys* StdMapIndex<mapType, transparentLookup, convertKeys>::newKeys(const SetAllocator& allocator) {
+    KeysAllocator keysAllocator(allocator);
+    Keys* keys = allocator_traits<KeysAllocator>::allocate(keysAllocator, 1);
+    return new(keys) Keys();
+}
+
+//--------------------------------------------------------------
+template<typename mapType, bool transparentLookup, bool convertKeys>
+void StdMapIndex<mapType, transparentLookup, convertKeys>::deleteKeys() {
+    if(!_keys) return;
+    KeysAllocator keysAllocator(_set.get_allocator());
+    allocator_traits<KeysAllocator>::deallocate(keysAllocator, _keys, 1);
+}
+
+//--------------------------------------------------------------
+template<typename mapType, bool transparentLookup, bool convertKeys>
+typename StdMapIndex<mapType, transparentLookup, convertKeys>::SetType StdMapIndex<mapType, transparentLookup, convertKeys>::newSet(const Keys* keys, const SetAllocator& allocator) {
+    if constexpr(hasBuckets<SetType>::value) {
+        typedef typename SetType::hasher Hash;
+        typedef typename SetType::key_equal KeyEqual;
+        return SetType(0, Hash{ {}, keys }, KeyEqual{ {}, keys }, allocator);
+    } else {
+        typedef typename SetType::key_compare Compare;
+        return SetType(Compare{ {}, keys }, allocator);
+    }
+}
+
+
+//--------------------------------------------------------------
+// FlatIndex implementation
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+FlatIndex<keyType, Hash, KeyEqual, Allocator>::FlatIndex(FlatIndex&& other)
+    : _ctrl(std::move(other._ctrl)), _slots(std::move(other._slots)), _size(other._size), _deleted(other._deleted),
+      _hash(std::move(other._hash)), _equal(std::move(other._equal)) {
+    other.release();
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+FlatIndex<keyType, Hash, KeyEqual, Allocator>& FlatIndex<keyType, Hash, KeyEqual, Allocator>::operator=(FlatIndex&& other) {
+    if(this == &other) return *this;
+    _ctrl = std::move(other._ctrl);
+    _slots = std::move(other._slots);
+    _size = other._size;
+    _deleted = other._deleted;
+    _hash = std::move(other._hash);
+    _equal = std::move(other._equal);
+    other.release();
+    return *this;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+void FlatIndex<keyType, Hash, KeyEqual, Allocator>::release() {
+    // with allocators which don't move, the vectors are moved item by item and still have their items
+    _ctrl.clear();
+    _slots.clear();
+    _size = _deleted = 0;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+int FlatIndex<keyType, Hash, KeyEqual, Allocator>::size() const {
+    return _size;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+void FlatIndex<keyType, Hash, KeyEqual, Allocator>::clear() {
+    // keep the allocated slots, like vector::clear()
+    fill(_ctrl.begin(), _ctrl.end(), int8_t(kEmpty));
+    _size = _deleted = 0;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+void FlatIndex<keyType, Hash, KeyEqual, Allocator>::reserve(int n, const KeyVector& keys) {
+    size_t numSlots = numSlotsFor(n);
+    if(numSlots > _ctrl.size()) rehash(numSlots, keys);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+void FlatIndex<keyType, Hash, KeyEqual, Allocator>::shrink_to_fit(const KeyVector& keys) {
+    if(_size == 0) {
+        decltype(_ctrl)(_ctrl.get_allocator()).swap(_ctrl);
+        decltype(_slots)(_slots.get_allocator()).swap(_slots);
+        _deleted = 0;
+    } else {
+        size_t numSlots = numSlotsFor(_size);
+        if(numSlots < _ctrl.size()) rehash(numSlots, keys);
+    }
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+size_t FlatIndex<keyType, Hash, KeyEqual, Allocator>::numSlotsFor(int n) {
+    // same load limit as insert, and a power of two number of groups
+    size_t numSlots = kGroupSize;
+    while(numSlots * 7 < size_t(n) * 8) numSlots *= 2;
+    return numSlots;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+int FlatIndex<keyType, Hash, KeyEqual, Allocator>::find(const K& key, const KeyVector& keys) const {
+    return findHashed(hashFor(key), key, keys);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+int FlatIndex<keyType, Hash, KeyEqual, Allocator>::insert(const keyType& key, int index, const KeyVector& keys, handle& h) {
+    h = hashFor(key);
+    int existingIndex = findHashed(h, key, keys);
+    if(existingIndex >= 0) return existingIndex;
+
+    // keep the load (including tombstones) under 7/8, if it's mostly tombstones just clean up without growing
+    size_t numSlots = _ctrl.size();
+    if(size_t(_size + _deleted + 1) * 8 > numSlots * 7) {
+        rehash(size_t(_size + 1) > numSlots / 2 ? max(numSlots * 2, size_t(kGroupSize)) : numSlots, keys);
+    }
+    insertSlot(h, index);
+    return -1;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+int FlatIndex<keyType, Hash, KeyEqual, Allocator>::findHashed(size_t h, const K& key, const KeyVector& keys) const {
+    if(_size == 0) return -1;
+    int8_t fp = fingerprint(h);
+    size_t mask = groupMask();
+    // triangular probing over groups, visits every group once as the number of groups is a power of two
+    for(size_t group = h & mask, step = 1; ; group = (group + step++) & mask) {
+        const int8_t* ctrl = &_ctrl[group * kGroupSize];
+        for(uint32_t m = matchGroup(ctrl, fp); m; m &= m - 1) {
+            int index = _slots[group * kGroupSize + lowestBit(m)];
+            if(_equal(keys[index], key)) return index;
+        }
+        if(matchEmpty(ctrl)) return -1;
+    }
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+void FlatIndex<keyType, Hash, KeyEqual, Allocator>::erase(handle h, int index, const KeyVector& /*keys*/) {
+    int slot = findSlot(h, index);
+    // if the group still has an empty slot, no probe ever continued past it, so this slot can become empty too
+    if(matchEmpty(&_ctrl[slot / kGroupSize * kGroupSize])) {
+        _ctrl[slot] = kEmpty;
+    } else {
+        _ctrl[slot] = kDeleted;
+        _deleted++;
+    }
+    _size--;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+void FlatIndex<keyType, Hash, KeyEqual, Allocator>::setIndex(handle h, int oldIndex, int newIndex) {
+    _slots[findSlot(h, oldIndex)] = newIndex;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+int FlatIndex<keyType, Hash, KeyEqual, Allocator>::rename(handle& h, int index, const keyType& newKey, const KeyVector& keys) {
+    size_t newHash = hashFor(newKey);
+    int existingIndex = findHashed(newHash, newKey, keys);
+    if(existingIndex >= 0) return existingIndex;
+
+    // the entry only holds the index, so move it to where the new hash puts it
+    erase(h, index, keys);
+    h = newHash;
+    if(size_t(_size + _deleted + 1) * 8 > _ctrl.size() * 7) rehash(_ctrl.size(), keys);   // only if the tombstone pushed the load over
+    insertSlot(h, index);
+    return -1;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+size_t FlatIndex<keyType, Hash, KeyEqual, Allocator>::hashFor(const K& key) const {
+    // std::hash is often the identity for integers, so mix the bits (fibonacci hashing)
+    // the multiply only carries entropy upwards, so the high half is folded back down onto the group bits
+    // (the fingerprint is the top 7 bits, which stay as they are)
+    size_t h = _hash(key) * size_t(0x9E3779B97F4A7C15ull);
+    return h ^ (h >> (sizeof(size_t) * 4));
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+uint32_t FlatIndex<keyType, Hash, KeyEqual, Allocator>::matchGroup(const int8_t* ctrl, int8_t fp) {
+#ifdef MSA_ORDEREDMAP_SSE2
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(fp)));
+#else
+    uint32_t mask = 0;
+    for(int i=0; i<kGroupSize; i++) if(ctrl[i] == fp) mask |= 1u << i;
+    return mask;
+#endif
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+uint32_t FlatIndex<keyType, Hash, KeyEqual, Allocator>::matchEmpty(const int8_t* ctrl) {
+    return matchGroup(ctrl, kEmpty);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+uint32_t FlatIndex<keyType, Hash, KeyEqual, Allocator>::matchFree(const int8_t* ctrl) {
+    // empty and deleted are the only negative control bytes
+#ifdef MSA_ORDEREDMAP_SSE2
+    return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl)));
+#else
+    uint32_t mask = 0;
+    for(int i=0; i<kGroupSize; i++) if(ctrl[i] < 0) mask |= 1u << i;
+    return mask;
+#endif
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+int FlatIndex<keyType, Hash, KeyEqual, Allocator>::lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return i;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+int FlatIndex<keyType, Hash, KeyEqual, Allocator>::findSlot(size_t h, int index) const {
+    int8_t fp = fingerprint(h);
+    size_t mask = groupMask();
+    for(size_t group = h & mask, step = 1; ; group = (group + step++) & mask) {
+        for(uint32_t m = matchGroup(&_ctrl[group * kGroupSize], fp); m; m &= m - 1) {
+            int slot = group * kGroupSize + lowestBit(m);
+            if(_slots[slot] == index) return slot;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+void FlatIndex<keyType, Hash, KeyEqual, Allocator>::insertSlot(size_t h, int index) {
+    size_t mask = groupMask();
+    for(size_t group = h & mask, step = 1; ; group = (group + step++) & mask) {
+        uint32_t m = matchFree(&_ctrl[group * kGroupSize]);
+        if(m) {
+            int slot = group * kGroupSize + lowestBit(m);
+            if(_ctrl[slot] == kDeleted) _deleted--;
+            _ctrl[slot] = fingerprint(h);
+            _slots[slot] = index;
+            _size++;
+            return;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename Hash, typename KeyEqual, typename Allocator>
+void FlatIndex<keyType, Hash, KeyEqual, Allocator>::rehash(size_t numSlots, const KeyVector& keys) {
+    decltype(_ctrl) oldCtrl(numSlots, int8_t(kEmpty), _ctrl.get_allocator());
+    decltype(_slots) oldSlots(numSlots, 0, _slots.get_allocator());
+    oldCtrl.swap(_ctrl);
+    oldSlots.swap(_slots);
+    _size = _deleted = 0;
+    for(size_t i=0; i<oldCtrl.size(); i++) {
+        if(oldCtrl[i] >= 0) insertSlot(hashFor(keys[oldSlots[i]]), oldSlots[i]);
+    }
+}
+
+
+
+//--------------------------------------------------------------
+// SmallIndex implementation
+//--------------------------------------------------------------
+template<typename keyType, int N, typename Hash, typename KeyEqual, typename Allocator>
+SmallIndex<keyType, N, Hash, KeyEqual, Allocator>::SmallIndex(SmallIndex&& other)
+    : _large(std::move(other._large)), _numSmall(other._numSmall), _isLarge(other._isLarge), _equal(std::move(other._equal)) {
+    copy(other._small, other._small + other._numSmall, _small);
+    other._numSmall = 0;
+    other._isLarge = false;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, int N, typename Hash, typename KeyEqual, typename Allocator>
+SmallIndex<keyType, N, Hash, KeyEqual, Allocator>& SmallIndex<keyType, N, Hash, KeyEqual, Allocator>::operator=(SmallIndex&& other) {
+    if(this == &other) return *this;
+    _large = std::move(other._large);
+    copy(other._small, other._small + other._numSmall, _small);
+    _numSmall = other._numSmall;
+    _isLarge = other._isLarge;
+    _equal = std::move(other._equal);
+    other._numSmall = 0;
+    other._isLarge = false;
+    return *this;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, int N, typename Hash, typename KeyEqual, typename Allocator>
+void SmallIndex<keyType, N, Hash, KeyEqual, Allocator>::reserve(int n, const KeyVector& keys) {
+    if(n <= N) return;
+    makeLarge(keys);
+    _large.reserve(n, keys);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, int N, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+int SmallIndex<keyType, N, Hash, KeyEqual, Allocator>::find(const K& key, const KeyVector& keys) const {
+    if(_isLarge) return _large.find(key, keys);
+    for(int i=0; i<_numSmall; i++) {
+        if(_equal(keys[_small[i]], key)) return _small[i];
+    }
+    return -1;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, int N, typename Hash, typename KeyEqual, typename Allocator>
+int SmallIndex<keyType, N, Hash, KeyEqual, Allocator>::insert(const keyType& key, int index, const KeyVector& keys, handle& h) {
+    if(!_isLarge) {
+        int existingIndex = find(key, keys);
+        if(existingIndex >= 0) return existingIndex;
+        if(_numSmall < N) {
+            _small[_numSmall++] = index;
+            h = _large.hashFor(key);
+            return -1;
+        }
+        makeLarge(keys);
+    }
+    return _large.insert(key, index, keys, h);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, int N, typename Hash, typename KeyEqual, typename Allocator>
+void SmallIndex<keyType, N, Hash, KeyEqual, Allocator>::erase(handle h, int index, const KeyVector& keys) {
+    if(_isLarge) {
+        _large.erase(h, index, keys);
+    } else {
+        _small[smallPosition(index)] = _small[--_numSmall];
+    }
+}
+
+//--------------------------------------------------------------
+template<typename keyType, int N, typename Hash, typename KeyEqual, typename Allocator>
+void SmallIndex<keyType, N, Hash, KeyEqual, Allocator>::setIndex(handle h, int oldIndex, int newIndex) {
+    if(_isLarge) _large.setIndex(h, oldIndex, newIndex);
+    else _small[smallPosition(oldIndex)] = newIndex;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, int N, typename Hash, typename KeyEqual, typename Allocator>
+int SmallIndex<keyType, N, Hash, KeyEqual, Allocator>::rename(handle& h, int index, const keyType& newKey, const KeyVector& keys) {
+    if(_isLarge) return _large.rename(h, index, newKey, keys);
+    // the slot stays the same, only the handle changes with the key
+    int existingIndex = find(newKey, keys);
+    if(existingIndex >= 0) return existingIndex;
+    h = _large.hashFor(newKey);
+    return -1;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, int N, typename Hash, typename KeyEqual, typename Allocator>
+int SmallIndex<keyType, N, Hash, KeyEqual, Allocator>::smallPosition(int index) const {
+    int i = 0;
+    while(_small[i] != index) i++;
+    return i;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, int N, typename Hash, typename KeyEqual, typename Allocator>
+void SmallIndex<keyType, N, Hash, KeyEqual, Allocator>::makeLarge(const KeyVector& keys) {
+    if(_isLarge) return;
+    // the handles are the hashes of the keys, so they come out the same as the ones already handed out
+    _large.reserve(N + 1, keys);
+    handle h;
+    for(int i=0; i<_numSmall; i++) _large.insert(keys[_small[i]], _small[i], keys, h);
+    _numSmall = 0;
+    _isLarge = true;
+}
+
+
+
+//--------------------------------------------------------------
+// DenseOrder implementation
+//--------------------------------------------------------------
+template<typename Allocator>
+void BasicDenseOrder<Allocator>::clear() {
+    _erased.clear();
+    _tree.clear();
+    _numErased = 0;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+void BasicDenseOrder<Allocator>::reserve(int numSlots) {
+    // nothing is allocated until the first tombstone anyway
+    if(_numErased == 0) return;
+    _erased.reserve(numSlots);
+    _tree.reserve(numSlots + 1);
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+void BasicDenseOrder<Allocator>::shrink_to_fit() {
+    _erased.shrink_to_fit();
+    _tree.shrink_to_fit();
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+int BasicDenseOrder<Allocator>::nextSlot(int slot, int numSlots) const {
+    do slot++; while(slot < numSlots && isFree(slot));
+    return slot < numSlots ? slot : -1;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+int BasicDenseOrder<Allocator>::prevSlot(int slot) const {
+    do slot--; while(slot >= 0 && isFree(slot));
+    return slot;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+int BasicDenseOrder<Allocator>::insert(int index, int numSlots) {
+    if(_numErased == 0) return index;
+
+    // new live slot at the end. its node covers (i - lowbit(i), i], i.e. itself plus the live slots in that range before it
+    int i = numSlots + 1;
+    _erased.push_back(0);
+    _tree.push_back(1 + rank(i - 1) - rank(i - (i & -i)));
+    return numSlots;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+void BasicDenseOrder<Allocator>::erase(int slot, int numSlots) {
+    if(_numErased == 0) {
+        // first tombstone, build the tree with all slots live
+        _erased.assign(numSlots, 0);
+        _tree.resize(numSlots + 1);
+        for(int i=1; i<=numSlots; i++) _tree[i] = i & -i;
+    }
+    _erased[slot] = 1;
+    _numErased++;
+    for(int i=slot+1; i<int(_tree.size()); i += i & -i) _tree[i]--;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+void BasicDenseOrder<Allocator>::truncate(int numSlots) {
+    if(numSlots >= int(_erased.size())) return;
+    for(int slot=numSlots; slot<int(_erased.size()); slot++) _numErased -= _erased[slot];
+    if(_numErased == 0) {
+        clear();
+    } else {
+        // nodes up to numSlots only cover slots up to numSlots, so are still valid
+        _erased.resize(numSlots);
+        _tree.resize(numSlots + 1);
+    }
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+int BasicDenseOrder<Allocator>::rank(int slot) const {
+    int count = 0;
+    for(int i=slot; i>0; i -= i & -i) count += _tree[i];
+    return count;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+int BasicDenseOrder<Allocator>::select(int index) const {
+    // find the last position with index live slots before it, descending the tree
+    int numSlots = _erased.size();
+    int pos = 0;
+    int step = 1;
+    while(step * 2 <= numSlots) step *= 2;
+    for(; step > 0; step /= 2) {
+        if(pos + step <= numSlots && _tree[pos + step] <= index) {
+            pos += step;
+            index -= _tree[pos];
+        }
+    }
+    return pos;
+}
+
+
+
+//--------------------------------------------------------------
+// TreeOrder implementation
+//--------------------------------------------------------------
+template<typename Allocator>
+void BasicTreeOrder<Allocator>::clear() {
+    _nodes.clear();
+    _free.clear();
+    _root = -1;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+int BasicTreeOrder<Allocator>::slotFor(int index) const {
+    int node = _root;
+    while(true) {
+        int leftCount = count(_nodes[node].left);
+        if(index < leftCount) {
+            node = _nodes[node].left;
+        } else if(index == leftCount) {
+            return node;
+        } else {
+            index -= leftCount + 1;
+            node = _nodes[node].right;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+int BasicTreeOrder<Allocator>::indexForSlot(int slot) const {
+    // everything in the left subtree comes before, plus everything left of each ancestor we're on the right of
+    int index = count(_nodes[slot].left);
+    for(int node = slot, parent = _nodes[slot].parent; parent >= 0; node = parent, parent = _nodes[parent].parent) {
+        if(_nodes[parent].right == node) index += count(_nodes[parent].left) + 1;
+    }
+    return index;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+int BasicTreeOrder<Allocator>::nextSlot(int slot, int /*numSlots*/) const {
+    // leftmost node of the right subtree, or the first ancestor we're on the left of
+    int node = _nodes[slot].right;
+    if(node >= 0) {
+        while(_nodes[node].left >= 0) node = _nodes[node].left;
+        return node;
+    }
+    for(node = slot; _nodes[node].parent >= 0; node = _nodes[node].parent) {
+        if(_nodes[_nodes[node].parent].left == node) return _nodes[node].parent;
+    }
+    return -1;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+int BasicTreeOrder<Allocator>::prevSlot(int slot) const {
+    // rightmost node of the left subtree, or the first ancestor we're on the right of
+    int node = _nodes[slot].left;
+    if(node >= 0) {
+        while(_nodes[node].right >= 0) node = _nodes[node].right;
+        return node;
+    }
+    for(node = slot; _nodes[node].parent >= 0; node = _nodes[node].parent) {
+        if(_nodes[_nodes[node].parent].right == node) return _nodes[node].parent;
+    }
+    return -1;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+int BasicTreeOrder<Allocator>::insert(int index, int numSlots) {
+    int slot;
+    if(_free.empty()) {
+        slot = numSlots;
+        _nodes.push_back(Node());
+    } else {
+        slot = _free.back();
+        _free.pop_back();
+    }
+
+    // xorshift for the priority
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+
+    Node& node = _nodes[slot];
+    node.left = node.right = node.parent = -1;
+    node.count = 1;
+    node.priority = _seed;
+
+    int a, b;
+    split(_root, index, a, b);
+    _root = merge(merge(a, slot), b);
+    _nodes[_root].parent = -1;
+    return slot;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+void BasicTreeOrder<Allocator>::erase(int slot, int /*numSlots*/) {
+    // replace the node with its merged children, and update the counts above it
+    Node& node = _nodes[slot];
+    int child = merge(node.left, node.right);
+    int parent = node.parent;
+    if(child >= 0) _nodes[child].parent = parent;
+    if(parent < 0) {
+        _root = child;
+    } else {
+        if(_nodes[parent].left == slot) _nodes[parent].left = child;
+        else _nodes[parent].right = child;
+        for(int p = parent; p >= 0; p = _nodes[p].parent) _nodes[p].count--;
+    }
+
+    node.left = node.right = node.parent = -1;
+    node.count = 0;
+    _free.push_back(slot);
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+void BasicTreeOrder<Allocator>::move(int first, int last, int dest) {
+    // cut the range out, and put it back in where the rest splits at dest
+    int before, range, after, rest;
+    split(_root, first, before, rest);
+    split(rest, last - first, range, after);
+    split(merge(before, after), dest, before, after);
+    _root = merge(merge(before, range), after);
+    if(_root >= 0) _nodes[_root].parent = -1;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+void BasicTreeOrder<Allocator>::truncate(int numSlots) {
+    // slots from numSlots onwards must be free
+    if(numSlots >= int(_nodes.size())) return;
+    _nodes.resize(numSlots);
+    _free.erase(remove_if(_free.begin(), _free.end(), [numSlots](int slot) { return slot >= numSlots; }), _free.end());
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+void BasicTreeOrder<Allocator>::update(int node) {
+    Node& n = _nodes[node];
+    n.count = 1 + count(n.left) + count(n.right);
+    if(n.left >= 0) _nodes[n.left].parent = node;
+    if(n.right >= 0) _nodes[n.right].parent = node;
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+int BasicTreeOrder<Allocator>::merge(int a, int b) {
+    if(a < 0) return b;
+    if(b < 0) return a;
+    if(_nodes[a].priority > _nodes[b].priority) {
+        _nodes[a].right = merge(_nodes[a].right, b);
+        update(a);
+        return a;
+    } else {
+        _nodes[b].left = merge(a, _nodes[b].left);
+        update(b);
+        return b;
+    }
+}
+
+//--------------------------------------------------------------
+template<typename Allocator>
+void BasicTreeOrder<Allocator>::split(int node, int index, int& a, int& b) {
+    if(node < 0) {
+        a = b = -1;
+        return;
+    }
+    int leftCount = count(_nodes[node].left);
+    if(index <= leftCount) {
+        split(_nodes[node].left, index, a, _nodes[node].left);
+        b = node;
+    } else {
+        split(_nodes[node].right, index - leftCount - 1, _nodes[node].right, b);
+        a = node;
+    }
+    update(node);
+}
+
+
+
+#ifdef MSA_ORDEREDMAP_PMR
+//--------------------------------------------------------------
+// InlineResource implementation
+//--------------------------------------------------------------
+template<size_t bufferSize>
+void* pmr::InlineResource<bufferSize>::do_allocate(size_t bytes, size_t alignment) {
+    size_t start = (_used + alignment - 1) / alignment * alignment;
+    if(alignment > alignof(max_align_t) || start + bytes > bufferSize) return _upstream->allocate(bytes, alignment);
+    _used = start + bytes;
+    _numBlocks++;
+    return _buffer + start;
+}
+
+//--------------------------------------------------------------
+template<size_t bufferSize>
+void pmr::InlineResource<bufferSize>::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    if(!inBuffer(p)) {
+        _upstream->deallocate(p, bytes, alignment);
+        return;
+    }
+    char* block = static_cast<char*>(p);
+    if(--_numBlocks == 0) _used = 0;
+    else if(block + bytes == _buffer + _used) _used = block - _buffer;
+}
+#endif
 
 }
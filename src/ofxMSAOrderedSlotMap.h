@@ -0,0 +1,505 @@
+//                                      __
+//     ____ ___  ___  ____ ___  ____   / /__   __
+//    / __ `__ \/ _ \/ __ `__ \/ __ \ / __/ | / /
+//   / / / / / /  __/ / / / / / /_/ // /_ | |/ /
+//  /_/ /_/ /_/\___/_/ /_/ /_/\____(_)__/ |___/
+//
+//
+//  Created by Memo Akten, www.memo.tv
+//
+//  a sibling of OrderedMap for registries of objects (e.g. entities, particles) which are added and erased all the time
+//  msa::OrderedSlotMap<string, Particle> particles;
+//  msa::OrderedSlotMap<string, Particle>::Handle h = particles.push_back(Particle());   // unnamed
+//  particles.push_back("emitter", Particle());                                           // named, so also found by key
+//
+//  items live in slots which never move, and are accessed with handles (a slot and its generation)
+//  erasing an item frees its slot for reuse and changes the slot's generation, so handles to it are stale (never another item)
+//  the order of insertion is kept in a separate linked list of slots, so adding and erasing are O(1)
+//  (no items or keys are shifted, and nothing in the key index needs updating), but there's no access by index
+//  items can optionally have a key, which goes in a key index (any OrderedMap index policy, FlatIndex by default)
+//
+
+#pragma once
+
+#include "ofxMSAOrderedMap.h"
+
+namespace msa {
+
+template<typename keyType, typename T, typename Index = FlatIndex<keyType>, typename Allocator = allocator<T> >
+class OrderedSlotMap {
+public:
+    typedef keyType key_type;
+    typedef T mapped_type;
+    typedef Allocator allocator_type;
+
+    // refers to an item for as long as it exists, whatever else is added or erased
+    struct Handle {
+        int slot = -1;
+        uint32_t generation = 0;
+    };
+
+    OrderedSlotMap() : OrderedSlotMap(Allocator()) {}
+    explicit OrderedSlotMap(const Allocator& allocator);
+
+    // copies rebuild the key index. handles to items work on copies, and on maps move constructed from the map they came from,
+    // but assigning to a map which has had items makes all handles from before stale (so they never alias the new items)
+    OrderedSlotMap(const OrderedSlotMap& other);
+    OrderedSlotMap(OrderedSlotMap&& other);
+    OrderedSlotMap& operator=(const OrderedSlotMap& other);
+    OrderedSlotMap& operator=(OrderedSlotMap&& other);
+
+    allocator_type get_allocator() const { return allocator_type(_values.get_allocator()); }
+
+    // iterators walk the items in order of insertion, *it is the item, it.handle() and it.key() are its handle and key
+    // NOTE: unlike OrderedMap, adding items doesn't invalidate iterators, only erasing the item they're on does
+    template<bool isConst> class Iterator;
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+
+    iterator begin()                        { return iterator(this, _head); }
+    const_iterator begin() const            { return const_iterator(this, _head); }
+    iterator end()                          { return iterator(this, -1); }
+    const_iterator end() const              { return const_iterator(this, -1); }
+
+    // get size
+    int size() const                        { return _size; }
+    bool empty() const                      { return _size == 0; }
+
+    // add new item at the end, returns a handle to it
+    // named items are added to the key index, these throw an exception if the key already exists
+    Handle push_back(const T& t);
+    Handle push_back(T&& t);
+    Handle push_back(const keyType& key, const T& t);
+    Handle push_back(keyType&& key, T&& t);
+
+    // add new named item, constructing it in place from args
+    template<typename... Args> Handle emplace_back(const keyType& key, Args&&... args);
+    template<typename... Args> Handle emplace_back(keyType&& key, Args&&... args);
+
+    // access by handle, a bounds and generation check and an array read
+    // at() throws an exception if the item has been erased (regardless of MSA_ORDEREDMAP_CHECKS), find() returns NULL
+    bool exists(const Handle& h) const      { return isLive(h); }
+    T& at(const Handle& h)                  { return _values[validateHandle(h, "msa::OrderedSlotMap::at(Handle)")]; }
+    const T& at(const Handle& h) const      { return _values[validateHandle(h, "msa::OrderedSlotMap::at(Handle)")]; }
+    T& operator[](const Handle& h)          { return at(h); }
+    const T& operator[](const Handle& h) const { return at(h); }
+    T* find(const Handle& h)                { return isLive(h) ? &_values[h.slot] : NULL; }
+    const T* find(const Handle& h) const    { return isLive(h) ? &_values[h.slot] : NULL; }
+
+    // access named items by key
+    // at() throws an exception if the key doesn't exist (if MSA_ORDEREDMAP_CHECKS is on), find() returns NULL
+    bool exists(const keyType& key) const   { return _index.find(key, _keys) >= 0; }
+    T& at(const keyType& key)               { return _values[validateKey(key, "msa::OrderedSlotMap::at(keyType)")]; }
+    const T& at(const keyType& key) const   { return _values[validateKey(key, "msa::OrderedSlotMap::at(keyType)")]; }
+    T& operator[](const keyType& key)       { return at(key); }
+    const T& operator[](const keyType& key) const { return at(key); }
+    T* find(const keyType& key)             { int slot = _index.find(key, _keys); return slot < 0 ? NULL : &_values[slot]; }
+    const T* find(const keyType& key) const { int slot = _index.find(key, _keys); return slot < 0 ? NULL : &_values[slot]; }
+
+    // handle for a named item, a stale handle if the key doesn't exist
+    Handle handleFor(const keyType& key) const;
+
+    // whether an item has a key, and its key (keyType() for unnamed items)
+    // keyFor throws an exception if the item has been erased
+    bool isNamed(const Handle& h) const     { return isLive(h) && _slots[h.slot].named; }
+    const keyType& keyFor(const Handle& h) const { return _keys[validateHandle(h, "msa::OrderedSlotMap::keyFor(Handle)")]; }
+
+    // first and last items in order (stale handles if empty)
+    Handle front() const                    { return handleForSlot(_head); }
+    Handle back() const                     { return handleForSlot(_tail); }
+
+    // erase by handle or key, O(1) (apart from the key index)
+    // throws an exception if the item doesn't exist (always for handles, if MSA_ORDEREDMAP_CHECKS is on for keys)
+    void erase(const Handle& h);
+    void erase(const keyType& key);
+
+    // reserve storage for n items (in the slots and the key index), so adding up to n items doesn't reallocate
+    void reserve(int n);
+
+    // clear, all handles become stale
+    void clear();
+
+    // full O(n) consistency check, throws an exception if anything is wrong (regardless of MSA_ORDEREDMAP_CHECKS)
+    void checkInvariants() const;
+
+private:
+    typedef typename Index::template rebind<Allocator> IndexType;
+    typedef typename IndexType::handle IndexHandle;
+
+    struct Slot {
+        int prev;               // neighbours in the order (-1 at either end), for free slots next is the next free slot
+        int next;
+        uint32_t generation;    // changes whenever the slot's item is erased
+        bool live;
+        bool named;             // whether the item's key is in the index
+    };
+
+    VectorFor<Slot, Allocator> _slots;
+    VectorFor<T, Allocator> _values;                // item in each slot (moved-from in free slots)
+    typename IndexType::KeyVector _keys;            // key of the item in each slot (keyType() if it isn't named)
+    VectorFor<IndexHandle, Allocator> _handles;     // handle to each named item's entry in the key index
+    IndexType _index;           // slot of each key
+    int _head = -1;             // first and last slots in the order
+    int _tail = -1;
+    int _free = -1;             // first free slot
+    int _size = 0;
+    uint32_t _firstGeneration = 0;  // generation of new slots
+    uint32_t _endGeneration = 0;    // more than any generation a slot of this map has had, so new slots after clearing start here
+
+    bool isLive(const Handle& h) const      { return h.slot >= 0 && h.slot < int(_slots.size()) && _slots[h.slot].live && _slots[h.slot].generation == h.generation; }
+    Handle handleForSlot(int slot) const    { return slot < 0 ? Handle() : Handle{ slot, _slots[slot].generation }; }
+
+    // errorMessage is only turned into a string if the exception is thrown, so validation doesn't allocate
+    int validateHandle(const Handle& h, const char* errorMessage) const;    // returns the slot
+    int validateKey(const keyType& key, const char* errorMessage) const;    // returns the slot
+
+    // add a new item at the end, constructing it from args, returns its slot
+    template<typename... Args> int emplaceSlot(Args&&... args);
+    template<typename K, typename... Args> Handle emplaceNamed(K&& key, Args&&... args);
+
+    void rebuildIndex();
+
+    // take the slots from another map (or a copy of them), with generations past any this map has handed out
+    void adoptGenerations(const OrderedSlotMap& other, uint32_t endGeneration);
+};
+
+
+//--------------------------------------------------------------
+// iterates the items in order, following the links between slots
+template<typename keyType, typename T, typename Index, typename Allocator>
+template<bool isConst>
+class OrderedSlotMap<keyType, T, Index, Allocator>::Iterator {
+public:
+    typedef typename conditional<isConst, const OrderedSlotMap, OrderedSlotMap>::type MapType;
+
+    typedef bidirectional_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef ptrdiff_t difference_type;
+    typedef typename conditional<isConst, const T*, T*>::type pointer;
+    typedef typename conditional<isConst, const T&, T&>::type reference;
+
+    Iterator() : _map(NULL), _slot(-1) {}
+    Iterator(const Iterator<false>& other) : _map(other._map), _slot(other._slot) {}  // iterator -> const_iterator
+
+    Handle handle() const                   { return _map->handleForSlot(_slot); }
+    const keyType& key() const              { return _map->_keys[_slot]; }
+
+    reference operator*() const             { return _map->_values[_slot]; }
+    pointer operator->() const              { return &_map->_values[_slot]; }
+
+    Iterator& operator++()                  { _slot = _map->_slots[_slot].next; return *this; }
+    Iterator& operator--()                  { _slot = _slot < 0 ? _map->_tail : _map->_slots[_slot].prev; return *this; }   // stepping back from end()
+    Iterator operator++(int)                { Iterator it = *this; ++*this; return it; }
+    Iterator operator--(int)                { Iterator it = *this; --*this; return it; }
+
+    bool operator==(const Iterator& other) const { return _slot == other._slot; }
+    bool operator!=(const Iterator& other) const { return _slot != other._slot; }
+
+private:
+    friend class OrderedSlotMap;
+    template<bool> friend class Iterator;
+
+    MapType* _map;
+    int _slot;  // -ve at end()
+
+    Iterator(MapType* map, int slot) : _map(map), _slot(slot) {}
+};
+
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+OrderedSlotMap<keyType, T, Index, Allocator>::OrderedSlotMap(const Allocator& allocator)
+    : _slots(allocator), _values(allocator), _keys(allocator), _handles(allocator), _index(allocator) {
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+OrderedSlotMap<keyType, T, Index, Allocator>::OrderedSlotMap(const OrderedSlotMap& other)
+    : OrderedSlotMap(allocator_traits<Allocator>::select_on_container_copy_construction(other.get_allocator())) {
+    *this = other;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+OrderedSlotMap<keyType, T, Index, Allocator>::OrderedSlotMap(OrderedSlotMap&& other)
+    : _slots(std::move(other._slots)), _values(std::move(other._values)), _keys(std::move(other._keys)),
+      _handles(std::move(other._handles)), _index(std::move(other._index)),
+      _head(other._head), _tail(other._tail), _free(other._free), _size(other._size),
+      _firstGeneration(other._firstGeneration), _endGeneration(other._endGeneration) {
+    // the index has moved over too, so the index handles are still valid, and so are handles to items
+    // the other map keeps its end generation, so its new slots never alias them
+    other.clear();
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+OrderedSlotMap<keyType, T, Index, Allocator>& OrderedSlotMap<keyType, T, Index, Allocator>::operator=(const OrderedSlotMap& other) {
+    if(this == &other) return *this;
+    uint32_t endGeneration = _endGeneration;
+    _slots = other._slots;
+    _values = other._values;
+    _keys = other._keys;
+    _handles = other._handles;
+    adoptGenerations(other, endGeneration);
+    rebuildIndex();
+    return *this;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+OrderedSlotMap<keyType, T, Index, Allocator>& OrderedSlotMap<keyType, T, Index, Allocator>::operator=(OrderedSlotMap&& other) {
+    if(this == &other) return *this;
+    // with different allocators the index nodes are moved one by one into new nodes, so the handles need rebuilding
+    bool sameNodes = allocator_traits<Allocator>::propagate_on_container_move_assignment::value || get_allocator() == other.get_allocator();
+    uint32_t endGeneration = _endGeneration;
+    _slots = std::move(other._slots);
+    _values = std::move(other._values);
+    _keys = std::move(other._keys);
+    _handles = std::move(other._handles);
+    adoptGenerations(other, endGeneration);
+    if(sameNodes) _index = std::move(other._index);
+    else rebuildIndex();
+    other.clear();
+    return *this;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+void OrderedSlotMap<keyType, T, Index, Allocator>::adoptGenerations(const OrderedSlotMap& other, uint32_t endGeneration) {
+    // _slots has already been copied or moved from other, the rest of its state is copied here
+    // the generations are offset past this map's, so the handles it handed out before are all stale
+    // (a map which has never had any items has nothing to offset, so handles carry over)
+    _head = other._head;
+    _tail = other._tail;
+    _free = other._free;
+    _size = other._size;
+    for(Slot& s : _slots) s.generation += endGeneration;
+    _firstGeneration = other._firstGeneration + endGeneration;
+    _endGeneration = other._endGeneration + endGeneration;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+void OrderedSlotMap<keyType, T, Index, Allocator>::rebuildIndex() {
+    _index.clear();
+    for(int slot=0; slot<int(_slots.size()); slot++) {
+        if(_slots[slot].live && _slots[slot].named) _index.insert(_keys[slot], slot, _keys, _handles[slot]);
+    }
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+typename OrderedSlotMap<keyType, T, Index, Allocator>::Handle OrderedSlotMap<keyType, T, Index, Allocator>::push_back(const T& t) {
+    return handleForSlot(emplaceSlot(t));
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+typename OrderedSlotMap<keyType, T, Index, Allocator>::Handle OrderedSlotMap<keyType, T, Index, Allocator>::push_back(T&& t) {
+    return handleForSlot(emplaceSlot(std::move(t)));
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+typename OrderedSlotMap<keyType, T, Index, Allocator>::Handle OrderedSlotMap<keyType, T, Index, Allocator>::push_back(const keyType& key, const T& t) {
+    return emplaceNamed(key, t);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+typename OrderedSlotMap<keyType, T, Index, Allocator>::Handle OrderedSlotMap<keyType, T, Index, Allocator>::push_back(keyType&& key, T&& t) {
+    return emplaceNamed(std::move(key), std::move(t));
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+template<typename... Args>
+typename OrderedSlotMap<keyType, T, Index, Allocator>::Handle OrderedSlotMap<keyType, T, Index, Allocator>::emplace_back(const keyType& key, Args&&... args) {
+    return emplaceNamed(key, std::forward<Args>(args)...);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+template<typename... Args>
+typename OrderedSlotMap<keyType, T, Index, Allocator>::Handle OrderedSlotMap<keyType, T, Index, Allocator>::emplace_back(keyType&& key, Args&&... args) {
+    return emplaceNamed(std::move(key), std::forward<Args>(args)...);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+template<typename K, typename... Args>
+typename OrderedSlotMap<keyType, T, Index, Allocator>::Handle OrderedSlotMap<keyType, T, Index, Allocator>::emplaceNamed(K&& key, Args&&... args) {
+    // the item goes into its slot before its key goes into the index (which is also the check for an existing key),
+    // so if the key exists or anything throws, the item is just erased again and the index never points at it
+    int slot = emplaceSlot(std::forward<Args>(args)...);
+    IndexHandle h{};
+    int existingSlot;
+    try {
+        _keys[slot] = std::forward<K>(key);
+        existingSlot = _index.insert(_keys[slot], slot, _keys, h);
+    } catch(...) {
+        _keys[slot] = keyType();
+        erase(handleForSlot(slot));
+        throw;
+    }
+    if(existingSlot >= 0) {
+        _keys[slot] = keyType();
+        erase(handleForSlot(slot));
+        throw invalid_argument("msa::OrderedSlotMap::push_back(keyType, T) - key already exists");
+    }
+    _handles[slot] = h;
+    _slots[slot].named = true;
+    return handleForSlot(slot);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+template<typename... Args>
+int OrderedSlotMap<keyType, T, Index, Allocator>::emplaceSlot(Args&&... args) {
+    int slot = _free;
+    if(slot >= 0) {
+        // reuse a free slot (once the item is constructed, in case that throws)
+        _values[slot] = T(std::forward<Args>(args)...);
+        _free = _slots[slot].next;
+    } else {
+        slot = _slots.size();
+        _values.emplace_back(std::forward<Args>(args)...);
+        _slots.push_back(Slot{ -1, -1, _firstGeneration, false, false });
+        _endGeneration = max(_endGeneration, _firstGeneration + 1);
+        _keys.emplace_back();
+        _handles.emplace_back();
+    }
+
+    // link in at the end
+    Slot& s = _slots[slot];
+    s.prev = _tail;
+    s.next = -1;
+    s.live = true;
+    s.named = false;
+    if(_tail >= 0) _slots[_tail].next = slot;
+    else _head = slot;
+    _tail = slot;
+    _size++;
+    return slot;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+typename OrderedSlotMap<keyType, T, Index, Allocator>::Handle OrderedSlotMap<keyType, T, Index, Allocator>::handleFor(const keyType& key) const {
+    int slot = _index.find(key, _keys);
+    return slot < 0 ? Handle() : handleForSlot(slot);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+void OrderedSlotMap<keyType, T, Index, Allocator>::erase(const Handle& h) {
+    int slot = validateHandle(h, "msa::OrderedSlotMap::erase(Handle)");
+    Slot& s = _slots[slot];
+    if(s.named) {
+        _index.erase(_handles[slot], slot, _keys);
+        _keys[slot] = keyType();
+    }
+
+    // unlink from the order
+    if(s.prev >= 0) _slots[s.prev].next = s.next;
+    else _head = s.next;
+    if(s.next >= 0) _slots[s.next].prev = s.prev;
+    else _tail = s.prev;
+
+    // the item is moved out and destroyed (so T doesn't need a default constructor), leaving a moved-from T in the slot
+    T released(std::move(_values[slot]));
+    (void)released;
+
+    s.live = false;
+    s.named = false;
+    s.generation++;
+    _endGeneration = max(_endGeneration, s.generation + 1);
+    s.prev = -1;
+    s.next = _free;
+    _free = slot;
+    _size--;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+void OrderedSlotMap<keyType, T, Index, Allocator>::erase(const keyType& key) {
+    erase(handleForSlot(validateKey(key, "msa::OrderedSlotMap::erase(keyType)")));
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+void OrderedSlotMap<keyType, T, Index, Allocator>::reserve(int n) {
+    _slots.reserve(n);
+    _values.reserve(n);
+    _keys.reserve(n);
+    _handles.reserve(n);
+    _index.reserve(n, _keys);
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+void OrderedSlotMap<keyType, T, Index, Allocator>::clear() {
+    // everything goes (keeping the capacity), and new slots start at a generation past any handed out,
+    // so that no handle becomes valid again
+    _slots.clear();
+    _values.clear();
+    _keys.clear();
+    _handles.clear();
+    _index.clear();
+    _head = _tail = _free = -1;
+    _size = 0;
+    _firstGeneration = _endGeneration;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+int OrderedSlotMap<keyType, T, Index, Allocator>::validateHandle(const Handle& h, const char* errorMessage) const {
+    if(!isLive(h)) throw invalid_argument(string(errorMessage) + " - handle is stale");
+    return h.slot;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+int OrderedSlotMap<keyType, T, Index, Allocator>::validateKey(const keyType& key, const char* errorMessage) const {
+    int slot = _index.find(key, _keys);
+#if MSA_ORDEREDMAP_CHECKS
+    if(slot < 0) throw invalid_argument(string(errorMessage) + " - key doesn't exist");
+#else
+    (void)errorMessage;
+#endif
+    return slot;
+}
+
+//--------------------------------------------------------------
+template<typename keyType, typename T, typename Index, typename Allocator>
+void OrderedSlotMap<keyType, T, Index, Allocator>::checkInvariants() const {
+    int numSlots = _slots.size();
+    if(int(_values.size()) != numSlots || int(_keys.size()) != numSlots || int(_handles.size()) != numSlots) throw runtime_error("msa::OrderedSlotMap::checkInvariants() - vector sizes don't match");
+
+    // walk the order, every slot in it must be live and linked both ways
+    int count = 0, numNamed = 0;
+    for(int slot=_head, prev=-1; slot>=0; prev=slot, slot=_slots[slot].next) {
+        if(slot >= numSlots || !_slots[slot].live || _slots[slot].prev != prev) throw runtime_error("msa::OrderedSlotMap::checkInvariants() - order is broken at slot " + ofToString(slot));
+        if(++count > _size) throw runtime_error("msa::OrderedSlotMap::checkInvariants() - order is longer than size");
+        if(_slots[slot].next < 0 && slot != _tail) throw runtime_error("msa::OrderedSlotMap::checkInvariants() - order doesn't end at the tail");
+        if(_slots[slot].named) {
+            numNamed++;
+            if(_index.find(_keys[slot], _keys) != slot) throw runtime_error("msa::OrderedSlotMap::checkInvariants() - key for slot " + ofToString(slot) + " isn't indexed correctly");
+        }
+    }
+    if(count != _size) throw runtime_error("msa::OrderedSlotMap::checkInvariants() - order is shorter than size");
+    if(_index.size() != numNamed) throw runtime_error("msa::OrderedSlotMap::checkInvariants() - index size doesn't equal number of named items");
+
+    // and every other slot must be on the free list
+    int numFree = 0;
+    for(int slot=_free; slot>=0; slot=_slots[slot].next) {
+        if(slot >= numSlots || _slots[slot].live) throw runtime_error("msa::OrderedSlotMap::checkInvariants() - free list is broken at slot " + ofToString(slot));
+        if(++numFree > numSlots) throw runtime_error("msa::OrderedSlotMap::checkInvariants() - free list loops");
+    }
+    if(count + numFree != numSlots) throw runtime_error("msa::OrderedSlotMap::checkInvariants() - slots are lost");
+    for(const Slot& s : _slots) {
+        if(s.generation >= _endGeneration || s.generation < _firstGeneration) throw runtime_error("msa::OrderedSlotMap::checkInvariants() - slot generation is out of range");
+    }
+}
+
+}
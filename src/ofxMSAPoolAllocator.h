@@ -0,0 +1,217 @@
+//                                      __
+//     ____ ___  ___  ____ ___  ____   / /__   __
+//    / __ `__ \/ _ \/ __ `__ \/ __ \ / __/ | / /
+//   / / / / / /  __/ / / / / / /_/ // /_ | |/ /
+//  /_/ /_/ /_/\___/_/ /_/ /_/\____(_)__/ |___/
+//
+//
+//  Created by Memo Akten, www.memo.tv
+//
+//  fixed size block pool allocator, for the nodes of node based containers
+//  e.g. the index of an OrderedMap with lots of insert / erase churn:
+//  msa::OrderedMap<string, T, msa::MapIndex<string>, msa::DenseOrder, msa::PoolAllocator<T> > myContainer;
+//
+//  single objects (i.e. nodes) come from a pool per object size, and go back on a free list when released,
+//  so the nodes are packed together in big chunks and churn doesn't fragment the heap
+//  anything else (e.g. vector storage) is passed through to operator new
+//  chunks are only freed when the last copy of the allocator is destroyed (i.e. with the container)
+//  NOTE: libstdc++ (at least up to 12) never destroys the allocator in a node handle which is inserted into a container,
+//  so extracting and reinserting nodes (e.g. std::map::extract / insert) leaks the pools (OrderedMap doesn't do this)
+//  not thread safe, like the containers using it
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include <memory>
+#include <new>
+
+#ifdef __linux__
+#define MSA_POOLALLOCATOR_HUGE_PAGES
+#include <sys/mman.h>
+#endif
+
+namespace msa {
+
+//--------------------------------------------------------------
+// pool of fixed size blocks, allocated in chunks which grow as the pool does
+// with hugePages (linux only), chunks are 2MB aligned mmaps backed by transparent huge pages,
+// which saves TLB misses when the nodes are scattered over lots of memory
+class NodePool {
+public:
+    NodePool(size_t blockSize, bool hugePages);
+    ~NodePool();
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    size_t blockSize() const { return _blockSize; }
+
+    void* allocate();
+    void deallocate(void* p);
+
+private:
+    enum { kMinChunkBlocks = 64, kMaxChunkSize = 1 << 21, kHugePageSize = 1 << 21 };
+
+    struct FreeBlock { FreeBlock* next; };
+    struct Chunk { void* memory; size_t size; bool mapped; };
+
+    size_t _blockSize;
+    bool _hugePages;
+    FreeBlock* _free;       // released blocks, reused first
+    char* _next;            // next unused block in the current chunk
+    char* _end;             // end of the current chunk
+    vector<Chunk> _chunks;
+
+    void addChunk();
+};
+
+
+//--------------------------------------------------------------
+// the pools for each block size, shared by all copies (and rebinds) of a PoolAllocator
+class NodePools {
+public:
+    explicit NodePools(bool hugePages) : _hugePages(hugePages) {}
+
+    NodePool& poolFor(size_t size);
+    bool hugePages() const { return _hugePages; }
+
+private:
+    vector< unique_ptr<NodePool> > _pools;   // a container only has a couple of node sizes, so this is a short list
+    bool _hugePages;
+};
+
+
+//--------------------------------------------------------------
+template<typename T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+
+    // copies of a container get their own pools (so two containers never share one)
+    // but moves and swaps take the pools with them, so their nodes can be moved without reallocating
+    typedef true_type propagate_on_container_move_assignment;
+    typedef true_type propagate_on_container_swap;
+    typedef false_type is_always_equal;
+
+    PoolAllocator() : PoolAllocator(false) {}
+    explicit PoolAllocator(bool hugePages) : _pools(make_shared<NodePools>(hugePages)), _pool(&_pools->poolFor(sizeof(T))) {}
+    template<typename U> PoolAllocator(const PoolAllocator<U>& other) : _pools(other._pools), _pool(&_pools->poolFor(sizeof(T))) {}
+
+    // allocators have to stay usable (and equal) when moved from, so moving one copies it rather than taking the pools
+    // (declaring these means there are no implicit moves, which would leave the moved-from allocator without pools)
+    PoolAllocator(const PoolAllocator& other) : _pools(other._pools), _pool(other._pool) {}
+    PoolAllocator& operator=(const PoolAllocator& other) { _pools = other._pools; _pool = other._pool; return *this; }
+
+    PoolAllocator select_on_container_copy_construction() const { return PoolAllocator(_pools->hugePages()); }
+
+    T* allocate(size_t n) {
+        if(n == 1) return static_cast<T*>(_pool->allocate());
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        if(n == 1) _pool->deallocate(p);
+        else ::operator delete(p);
+    }
+
+    template<typename U> bool operator==(const PoolAllocator<U>& other) const { return _pools == other._pools; }
+    template<typename U> bool operator!=(const PoolAllocator<U>& other) const { return _pools != other._pools; }
+
+private:
+    template<typename U> friend class PoolAllocator;
+
+    shared_ptr<NodePools> _pools;
+    NodePool* _pool;        // the pool for sizeof(T), looked up once when the allocator is (re)bound rather than on every node
+};
+
+
+
+//--------------------------------------------------------------
+// NodePool implementation
+//--------------------------------------------------------------
+inline NodePool::NodePool(size_t blockSize, bool hugePages)
+    : _blockSize(max(blockSize, sizeof(FreeBlock))), _hugePages(hugePages), _free(NULL), _next(NULL), _end(NULL) {
+    // keep every block aligned for anything
+    size_t alignment = alignof(max_align_t);
+    _blockSize = (_blockSize + alignment - 1) / alignment * alignment;
+}
+
+//--------------------------------------------------------------
+inline NodePool::~NodePool() {
+    for(const Chunk& chunk : _chunks) {
+#ifdef MSA_POOLALLOCATOR_HUGE_PAGES
+        if(chunk.mapped) {
+            munmap(chunk.memory, chunk.size);
+            continue;
+        }
+#endif
+        ::operator delete(chunk.memory);
+    }
+}
+
+//--------------------------------------------------------------
+inline void* NodePool::allocate() {
+    if(_free) {
+        FreeBlock* block = _free;
+        _free = block->next;
+        return block;
+    }
+    if(_next == _end) addChunk();
+    void* block = _next;
+    _next += _blockSize;
+    return block;
+}
+
+//--------------------------------------------------------------
+inline void NodePool::deallocate(void* p) {
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->next = _free;
+    _free = block;
+}
+
+//--------------------------------------------------------------
+inline void NodePool::addChunk() {
+    // double the pool each time, up to a maximum chunk size
+    size_t numBlocks = kMinChunkBlocks;
+    if(!_chunks.empty()) numBlocks = max(numBlocks, _chunks.back().size / _blockSize * 2);
+    numBlocks = max(size_t(1), min(numBlocks, kMaxChunkSize / _blockSize));
+    Chunk chunk = { NULL, numBlocks * _blockSize, false };
+
+#ifdef MSA_POOLALLOCATOR_HUGE_PAGES
+    if(_hugePages) {
+        // whole huge pages, mapped with an extra page so the start can be aligned to one
+        chunk.size = (chunk.size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+        size_t mappedSize = chunk.size + kHugePageSize;
+        void* mapped = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mapped != MAP_FAILED) {
+            char* start = static_cast<char*>(mapped);
+            char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(start) + kHugePageSize - 1) / kHugePageSize * kHugePageSize);
+            if(aligned != start) munmap(start, aligned - start);
+            if(start + mappedSize != aligned + chunk.size) munmap(aligned + chunk.size, start + mappedSize - (aligned + chunk.size));
+            madvise(aligned, chunk.size, MADV_HUGEPAGE);    // only advice, the kernel may still use normal pages
+            chunk.memory = aligned;
+            chunk.mapped = true;
+        }
+    }
+#endif
+    if(!chunk.memory) chunk.memory = ::operator new(chunk.size);    // throws bad_alloc
+
+    _chunks.push_back(chunk);
+    _next = static_cast<char*>(chunk.memory);
+    _end = _next + chunk.size / _blockSize * _blockSize;
+}
+
+
+//--------------------------------------------------------------
+// NodePools implementation
+//--------------------------------------------------------------
+inline NodePool& NodePools::poolFor(size_t size) {
+    for(auto& pool : _pools) {
+        if(pool->blockSize() >= size && pool->blockSize() < size + alignof(max_align_t)) return *pool;
+    }
+    _pools.push_back(unique_ptr<NodePool>(new NodePool(size, _hugePages)));
+    return *_pools.back();
+}
+
+}